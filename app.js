@@ -4,12 +4,16 @@ const createError = require('http-errors');
 const express = require('express');
 const path = require('path');
 const cookieParser = require('cookie-parser');
-const logger = require('morgan');
-const hbs = require('hbs');
+const compression = require('compression');
+const views = require('./app_server/services/views');
 const passport = require('passport');
 
 require('./app_api/database/db');
 require('./app_api/config/passport');
+const readiness = require('./app_api/services/readiness');
+const metrics = require('./app_api/services/metrics');
+const { accessLog } = require('./app_api/services/accessLog');
+const tracing = require('./app_api/services/tracing');
 
 const indexRouter = require('./app_server/routes/index');
 const usersRouter = require('./app_server/routes/users');
@@ -20,13 +24,29 @@ const app = express();
 
 // view engine setup
 app.set('views', path.join(__dirname, 'app_server', 'views'));
-// register handlebars partials (https://www.npmjs.com/package/hbs)
-    hbs.registerPartials(path.join(__dirname, 'app_server', 'views/partials'));
+// compile handlebars views and partials up front rather than on first render
+views.precompile(app.get('views'));
+app.engine('hbs', views.engine);
 
 app.set('view engine', 'hbs');
 
-app.use(logger('dev'));
-app.use(express.json());
+// health checks and metrics come first so probes and scrapes stay out of
+// the access log and the latency histograms
+app.get('/healthz', readiness.liveness);
+app.get('/readyz', readiness.readiness);
+app.get('/metrics', metrics.endpoint);
+
+app.use(tracing.middleware);
+app.use(metrics.httpMetrics);
+
+app.use(accessLog);
+// gzip/brotli for SSR pages, static files and uncached API responses; cached
+// catalog bodies arrive precompressed and are passed through untouched
+app.use(compression());
+// default 100 kb limit everywhere except bulk trip writes, which parse
+// their larger body in the route, only once the caller is authenticated
+const jsonBody = express.json();
+app.use((req, res, next) => (req.path === '/api/trips/bulk' ? next() : jsonBody(req, res, next)));
 app.use(express.urlencoded({ extended: false }));
 app.use(cookieParser());
 app.use(express.static(path.join(__dirname, 'public')));
@@ -37,9 +57,13 @@ app.use('/api', (req, res, next) => {
     res.header('Access-Control-Allow-Origin', 'http://localhost:4200');
     res.header('Access-Control-Allow-Headers', 'Origin, X-Requested-With, Content-Type, Accept, Authorization');
     res.header('Access-Control-Allow-Methods', 'GET, POST, PUT, DELETE');
+    res.header('Access-Control-Expose-Headers', 'ETag, Link');
     next();
 });
 
+// at startup, hold database-backed requests until MongoDB is connected and the catalog is warm
+app.use(['/api', '/travel'], readiness.gate);
+
 app.use('/', indexRouter);
 app.use('/users', usersRouter);
 app.use('/travel', travelRouter);
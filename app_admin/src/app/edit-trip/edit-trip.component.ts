@@ -46,7 +46,7 @@ export class EditTripComponent implements OnInit {
       .then(data => {
         console.log(data);
         // Don't use editForm.setValue() as it will throw console error
-        this.editForm.patchValue(data[0]);
+        this.editForm.patchValue(data);
       })
   }
 
@@ -7,5 +7,15 @@ export interface Trip {
   resort: string,
   perPerson: string,
   image: string,
-  description: string
+  description: string,
+  price?: number, // per-person price in cents, derived from perPerson
+  nights?: number // derived from length
 }
+
+// A code requested from GET /api/trips?codes= that matched no trip
+export interface TripNotFound {
+  code: string,
+  notFound: true
+}
+
+export type TripLookup = Trip | TripNotFound;
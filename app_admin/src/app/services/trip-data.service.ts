@@ -1,7 +1,7 @@
 import { Injectable, Inject } from '@angular/core';
 import { Http, Headers, RequestOptions } from '@angular/http';
 
-import { Trip } from '../models/trip';
+import { Trip, TripLookup } from '../models/trip';
 import { User } from '../models/user';
 import { AuthResponse } from '../models/authresponse';
 import { BROWSER_STORAGE } from '../storage';
@@ -53,6 +53,17 @@ export class TripDataService {
       });
   }
 
+  // Fetches several trips in one request; codes that don't exist come back
+  // as { code, notFound: true } in their requested position
+  public getTripsByCodes(codes: string[]): Promise<TripLookup[]> {
+    console.log('Inside TripDataService#getTripsByCodes');
+    return this.http
+      .get(this.tripUrl + '?codes=' + codes.map(encodeURIComponent).join(','))
+      .toPromise()
+      .then(response => response.json() as TripLookup[])
+      .catch(this.handleError);
+  }
+
   public updateTrip(formData: Trip): Promise<Trip> {
     console.log('Inside TripDataService#upateTrip');
     console.log(formData);
@@ -14,12 +14,15 @@ passport.use(new LocalStrategy({
                     message: 'Incorrect username.'
                 });
             }
-            if (!user.validPassword(password)) {
-                return done(null, false, {
-                    message: 'Incorrect password.'
-                });
-            }
-            return done(null, user);
+            user.validPassword(password)
+                .then(valid => {
+                    if (!valid) {
+                        return done(null, false, {
+                            message: 'Incorrect password.'
+                        });
+                    }
+                    return done(null, user);
+                }, done);
         });
     }
 ));
\ No newline at end of file
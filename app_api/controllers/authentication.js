@@ -2,6 +2,20 @@ const passport = require('passport');
 const mongoose = require('mongoose');
 const User = mongoose.model('users');
 
+// Password hashing is shed under load rather than queued without bound
+const hashError = (res, err) => {
+    if (err.code === 'EHASHQUEUEFULL') {
+        // same answer loginThrottle gives when it sees the queue full first
+        return res
+            .status(429)
+            .set('Retry-After', '1')
+            .json({ "message": "Server is busy, try again shortly" });
+    }
+    return res
+        .status(500)
+        .json({ "message": err.message });
+};
+
 const register = (req, res) => {
     if (!req.body.name || !req.body.email || !req.body.password) {
         return res
@@ -11,19 +25,21 @@ const register = (req, res) => {
     const user = new User();
     user.name = req.body.name; 
     user.email = req.body.email;
-    user.setPassword(req.body.password);
-    user.save((err) => {
-        if (err) {
-            res
-                .status(400)
-                .json(err);
-        } else {
-            const token = user.generateJwt();
-            res
-                .status(200)
-                .json({ token });
-        }
-    })
+    user.setPassword(req.body.password)
+        .then(() => {
+            user.save((err) => {
+                if (err) {
+                    res
+                        .status(400)
+                        .json(err);
+                } else {
+                    const token = user.generateJwt();
+                    res
+                        .status(200)
+                        .json({ token });
+                }
+            });
+        }, err => hashError(res, err));
 };
 const login = (req, res) => {
     if (!req.body.email || !req.body.password) {
@@ -32,6 +48,9 @@ const login = (req, res) => {
             .json({ "message": "All fields required" });
     }
     passport.authenticate('local', (err, user, info) => {
+        if (err && err.code === 'EHASHQUEUEFULL') {
+            return hashError(res, err);
+        }
         if (err) {
             return res
                 .status(404)
@@ -2,173 +2,317 @@
 
 const mongoose = require('mongoose'); // .set('debug', true);
 const Trip = mongoose.model('trips');
-const User = mongoose.model('users');
+const { tripReads } = require('../database/db');
+const tripCache = require('../services/tripCache');
+const tripData = require('../services/tripData');
+const tripQuery = require('../services/tripQuery');
+const tripStream = require('../services/tripStream');
+const tripSearch = require('../services/tripSearch');
+const tripBulk = require('../services/tripBulk');
+const precompress = require('../services/precompress');
 
-// GET: /trips - lists all the trips
-const tripsList = async (req, res) => {
+// Cached bodies are already JSON; precompress.send handles ETag/304 and encoding
+const sendEntry = (req, res, entry) => precompress.send(req, res, entry, 'json');
+
+// GET: /trips?limit=&after=&fields=&sort=... - one filtered keyset page of trips
+const tripsPage = (req, res) => {
+    const { filter, projection, sort, limit, cursor, error } = tripQuery.parse(req.query);
+    if (error) {
+        return res
+            .status(400)
+            .json({ "message": error });
+    }
     Trip
-        .find({}) // empty filter for all
+        .find(filter, projection)
+        .setOptions(tripReads)
+        .sort(sort)
+        .limit(limit + 1) // one extra to tell whether another page follows
+        .lean()
         .exec((err, trips) => {
-            if (!trips) {
+            if (err) {
                 return res
                     .status(404)
-                    .json({ "message": "trips not found" });
-            } else if (err) {
+                    .json(err);
+            }
+            if (trips.length > limit) {
+                trips.pop();
+                const after = cursor(trips[trips.length - 1]);
+                res.set('Link', tripQuery.nextLink(req.baseUrl + req.path, req.query, after));
+            }
+            return res
+                .status(200)
+                .json(trips);
+        });
+};
+
+// GET: /trips?stream=json|ndjson - the whole catalog, streamed from a cursor
+const tripsStream = (req, res) => {
+    const format = req.query.stream || 'ndjson';
+    if (!tripStream.isFormat(format)) {
+        return res
+            .status(400)
+            .json({ "message": "stream must be json or ndjson" });
+    }
+    const { filter, projection, sort, error } = tripQuery.parse(req.query);
+    if (error) {
+        return res
+            .status(400)
+            .json({ "message": error });
+    }
+    return tripStream.streamTrips(res, format, filter, projection, sort);
+};
+
+const MAX_CODES = 100;
+
+// Trips for the requested codes in request order, with a marker for misses
+const inRequestOrder = (codes, trips) => {
+    const byCode = new Map(trips.map(trip => [trip.code, trip]));
+    return codes.map(code => byCode.get(code) || { code, notFound: true });
+};
+
+// GET: /trips?codes=A,B,C - many trips in one round trip
+const tripsByCodes = (req, res) => {
+    const codes = String(req.query.codes).split(',').map(code => code.trim()).filter(Boolean);
+    if (!codes.length || codes.length > MAX_CODES) {
+        return res
+            .status(400)
+            .json({ "message": `codes must list 1 to ${MAX_CODES} trip codes` });
+    }
+    if (tripCache.isWarm()) {
+        const trips = codes.map(code => tripCache.findByCode(code)).filter(Boolean);
+        return res
+            .status(200)
+            .json(inRequestOrder(codes, trips));
+    }
+    Trip
+        .find({ code: { $in: codes } }) // one pass over the unique code index
+        .setOptions(tripReads)
+        .lean()
+        .exec((err, trips) => {
+            if (err) {
                 return res
                     .status(404)
                     .json(err);
-            } else {
+            }
+            return res
+                .status(200)
+                .json(inRequestOrder(codes, trips));
+        });
+};
+
+// GET: /trips - lists all the trips
+const tripsList = async (req, res) => {
+    if (req.query.codes !== undefined) {
+        return tripsByCodes(req, res);
+    }
+    if (req.query.stream !== undefined || req.accepts(['json', 'application/x-ndjson']) === 'application/x-ndjson') {
+        return tripsStream(req, res);
+    }
+    if (tripQuery.isPaged(req.query)) {
+        return tripsPage(req, res);
+    }
+    const cached = tripCache.getListEntry();
+    if (cached) {
+        return sendEntry(req, res, cached);
+    }
+    tripData.listTrips()
+        .then(trips => {
+            if (!trips) {
                 return res
-                    .status(200)
-                    .json(trips);
+                    .status(404)
+                    .json({ "message": "trips not found" });
             }
+            return res
+                .status(200)
+                .json(trips);
+        }, err => {
+            return res
+                .status(404)
+                .json(err);
         });
 };
 
 // GET /trips/:tripCode - returns a single trip
 const tripsFindCode = async (req, res) => {
-    Trip
-        .find({ 'code': req.params.tripCode })
-        .exec((err, trip) => {
+    if (tripCache.isWarm()) {
+        const cached = tripCache.getCodeEntry(req.params.tripCode);
+        if (!cached) {
+            return res
+                .status(404)
+                .json({ "message": "trip not found" });
+        }
+        return sendEntry(req, res, cached);
+    }
+    tripData.findTrip(req.params.tripCode)
+        .then(trip => {
             if (!trip) {
                 return res
                     .status(404)
                     .json({ "message": "trip not found" });
-            } else if (err) {
+            }
+            return res
+                .status(200)
+                .json(trip);
+        }, err => {
+            return res
+                .status(404)
+                .json(err);
+        });
+};
+
+// GET /trips/search?q=&page=&limit= - ranked text search with facet counts
+const tripsSearch = async (req, res) => {
+    const search = tripSearch.parse(req.query);
+    if (search.error) {
+        return res
+            .status(400)
+            .json({ "message": search.error });
+    }
+    Trip
+        .aggregate(tripSearch.pipeline(search))
+        .option(tripReads)
+        .exec((err, facets) => {
+            if (err) {
                 return res
-                    .status(404)
+                    .status(400)
                     .json(err);
-            } else {
-                return res
-                    .status(200)
-                    .json(trip);
             }
+            return res
+                .status(200)
+                .json(tripSearch.toResponse(search, facets));
         });
 };
 
+// Write handlers run behind 'auth' and 'resolveUser', so req.user is set
+
 const tripsAddTrip = async (req, res) => {
-    getUser(req, res,
-        (req, res) => {
-            Trip
-                .create({
-                    code: req.body.code,
-                    name: req.body.name,
-                    length: req.body.length,
-                    start: req.body.start,
-                    resort: req.body.resort,
-                    perPerson: req.body.perPerson,
-                    image: req.body.image,
-                    description: req.body.description
-                },
-                    (err, trip) => {
-                        if (err) {
-                            return res
-                                .status(400) // bad request
-                                .json(err);
-                        } else {
-                            return res
-                                .status(201) // created
-                                .json(trip);
-                        }
-                    });
-        }
-    );
+    Trip
+        .create({
+            code: req.body.code,
+            name: req.body.name,
+            length: req.body.length,
+            start: req.body.start,
+            resort: req.body.resort,
+            perPerson: req.body.perPerson,
+            image: req.body.image,
+            description: req.body.description
+        },
+            (err, trip) => {
+                if (err) {
+                    return res
+                        .status(400) // bad request
+                        .json(err);
+                } else {
+                    tripCache.invalidate();
+                    return res
+                        .status(201) // created
+                        .json(trip);
+                }
+            });
 }
 
 const tripsUpdateTrip = async (req, res) => {
-    getUser(req, res,
-        (req, res) => {
-            Trip
-                .findOneAndUpdate({ 'code': req.params.tripCode }, {
-                    code: req.body.code,
-                    name: req.body.name,
-                    length: req.body.length,
-                    start: req.body.start,
-                    resort: req.body.resort,
-                    perPerson: req.body.perPerson,
-                    image: req.body.image,
-                    description: req.body.description
-                }, { new: true })
-                .then(trip => {
-                    if (!trip) {
-                        return res
-                            .status(404)
-                            .send({
-                                message: "Trip not found with code" + req.params.tripCode
+    Trip
+        .findOneAndUpdate({ 'code': req.params.tripCode }, {
+            code: req.body.code,
+            name: req.body.name,
+            length: req.body.length,
+            start: req.body.start,
+            resort: req.body.resort,
+            perPerson: req.body.perPerson,
+            image: req.body.image,
+            description: req.body.description
+        }, { new: true })
+        .then(trip => {
+            if (!trip) {
+                return res
+                    .status(404)
+                    .send({
+                        message: "Trip not found with code" + req.params.tripCode
  });
-                    }
-                    res.send(trip);
-                }).catch(err => {
-                    if (err.kind === 'ObjectId') {
-                        return res
-                            .status(404)
-                            .send({
-                                message: "Trip not found with code" + req.params.tripCode
+            }
+            tripCache.invalidate();
+            res.send(trip);
+        }).catch(err => {
+            if (err.kind === 'ObjectId') {
+                return res
+                    .status(404)
+                    .send({
+                        message: "Trip not found with code" + req.params.tripCode
  });
-                    }
-                    return res
-                        .status(500) // server error
-                        .json(err);
-                });
-        }
-    );
+            }
+            return res
+                .status(500) // server error
+                .json(err);
+        });
 }
 
-const getUser = (req, res, callback) => {
-    if (req.payload && req.payload.email) {
-        User.findOne({ email: req.payload.email })
-            .exec((err, user) => {
-                if (!user) {
-                    return res
-                        .status(404)
-                        .json({ "message": "User not found" });
-                } else if (err) {
-                    console.log(err);
-                    return res
-                        .status(404)
-                        .json(err);
-                }
-                callback(req, res, user.name);
+// POST /trips/bulk - many inserts/updates/deletes in one bulkWrite
+const tripsBulk = async (req, res) => {
+    const batch = tripBulk.parse(req.body);
+    if (batch.error) {
+        return res
+            .status(400)
+            .json({ "message": batch.error, "errors": batch.errors });
+    }
+    const codes = batch.operations
+        .filter(({ op }) => op !== 'insert')
+        .map(({ code }) => code);
+    try {
+        const existing = codes.length
+            ? await Trip.find({ code: { $in: codes } }, { code: 1 }).lean()
+            : [];
+        const found = tripBulk.expectedMatches(batch.operations, existing.map(({ code }) => code));
+        let result;
+        let writeErrors = [];
+        try {
+            result = await Trip.bulkWrite(batch.operations.map(({ model }) => model),
+                { ordered: batch.ordered });
+        } catch (err) {
+            if (!err.writeErrors && !err.result) {
+                throw err;
+            }
+            // BulkWriteError: some operations failed, the rest may have landed
+            result = err.result;
+            writeErrors = [].concat(err.writeErrors || []);
+        }
+        tripCache.invalidate();
+        return res
+            .status(200)
+            .json({
+                inserted: result.nInserted,
+                updated: result.nModified,
+                deleted: result.nRemoved,
+                results: tripBulk.toResults(batch, found, writeErrors)
             });
-    } else {
+    } catch (err) {
         return res
-            .status(404)
-            .json({ "message": "User not found" });
+            .status(500) // server error
+            .json(err);
     }
 };
 
 const tripsDeleteTrip = async (req, res) => {
-    if (req.payload && req.payload.email) {
-        User.findOne({ email: req.payload.email })
-            .exec((err, user) => {
-                if (!user) {
-                    return res.status(404).json({ "message": "User not authorized or not found" });
-                } else if (err) {
-                    console.log(err);
-                    return res.status(404).json(err);
-                } else {
-                    Trip.findOneAndDelete({ 'code': req.params.tripCode })
-                        .exec((err, trip) => {
-                            if (err) {
-                                return res.status(400).json(err); // bad request
-                            } else if (!trip) {
-                                return res.status(404).json({ "message": "Trip not found" });
-                            } else {
-                                return res.status(204).json(null); // no content, successful deletion
-                            }
-                        });
-                }
-            });
-    } else {
-        return res.status(401).json({ "message": "User not authorized" });
-    }
+    Trip.findOneAndDelete({ 'code': req.params.tripCode })
+        .exec((err, trip) => {
+            if (err) {
+                return res.status(400).json(err); // bad request
+            } else if (!trip) {
+                return res.status(404).json({ "message": "Trip not found" });
+            } else {
+                tripCache.invalidate();
+                return res.status(204).json(null); // no content, successful deletion
+            }
+        });
 };
 
 module.exports = {
     tripsList,
     tripsFindCode,
+    tripsSearch,
     tripsAddTrip,
     tripsUpdateTrip,
-    tripsDeleteTrip
+    tripsDeleteTrip,
+    tripsBulk
 };
 
@@ -0,0 +1,12 @@
+// MongoDB connection settings shared by the app (db.js) and the migration
+// scripts, which can't require db.js since it connects on load.
+//   DB_URI    full connection string; can name a replica set, e.g.
+//             mongodb://a,b,c/travlr?replicaSet=rs0
+//   DB_HOST   host of a standalone server, used when DB_URI is unset
+
+const host = process.env.DB_HOST || '127.0.0.1';
+const dbURI = process.env.DB_URI || `mongodb://${host}/travlr`;
+
+module.exports = {
+    dbURI
+};
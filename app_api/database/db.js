@@ -1,22 +1,55 @@
 // Where the code connects the Express application to MongoDB
 
 const mongoose = require('mongoose');
-const host = process.env.DB_HOST || '127.0.0.1';
-const dbURI = `mongodb://${host}/travlr`;
+const { dbURI } = require('./config');
 const readline = require('readline');
+const poolMetrics = require('./poolMetrics');
+const metrics = require('../services/metrics');
+const tracing = require('../services/tracing');
+
+const poolSize = parseInt(process.env.DB_POOL_SIZE, 10) || 10;
+const waitQueueTimeoutMS = parseInt(process.env.DB_WAIT_QUEUE_TIMEOUT_MS, 10) || 0;
+
+// Read-only trip queries may go to secondaries (DB_READ_PREFERENCE, e.g.
+// secondaryPreferred) as long as they lag the primary by no more than
+// DB_MAX_STALENESS_SECONDS (90 is the smallest the driver accepts)
+const readMode = process.env.DB_READ_PREFERENCE || 'primary';
+const maxStalenessSeconds = parseInt(process.env.DB_MAX_STALENESS_SECONDS, 10) || 90;
+const tripReads = readMode === 'primary' ? {} : {
+    readPreference: new mongoose.mongo.ReadPreference(readMode, null, { maxStalenessSeconds })
+};
 
 // avoid 'current Server Discovery and Monitoring engine is deprecated'
 mongoose.set('useUnifiedTopology', true);
 
-const connect = () => {
-    setTimeout(() => mongoose.connect(dbURI, {
+// time and trace every operation; must be registered before the models below compile
+mongoose.plugin(metrics.mongoosePlugin);
+mongoose.plugin(tracing.mongoosePlugin);
+metrics.registerPoolMetrics(poolMetrics.snapshot);
+
+// Connect straight away; if the server isn't reachable yet, retry with
+// exponential backoff (plus jitter) instead of a fixed startup delay.
+// Once connected, the driver handles reconnects itself.
+const RETRY_MIN_MS = 250;
+const RETRY_MAX_MS = 30 * 1000;
+
+const connect = (attempt = 0) => {
+    mongoose.connect(dbURI, {
         useNewUrlParser: true,
-        useCreateIndex: true
-    }), 1000);
+        useCreateIndex: true,
+        poolSize,
+        waitQueueTimeoutMS
+    }).catch(err => {
+        const delay = Math.min(RETRY_MAX_MS, RETRY_MIN_MS * 2 ** attempt);
+        const jittered = Math.round(delay / 2 + Math.random() * delay / 2);
+        console.log(`Mongoose connect failed (${err.message}), retrying in ${jittered} ms`);
+        setTimeout(() => connect(attempt + 1), jittered);
+    });
 }
 
 mongoose.connection.on('connected', () => {
     console.log(`Mongoose connected to ${dbURI}`);
+    poolMetrics.attach(mongoose.connection.getClient());
 });
 
 mongoose.connection.on('error', err => {
@@ -70,3 +103,8 @@ connect();
 // bring in the Mongoose schema
 require('./models/travlr');
 require('./models/user');
+
+module.exports = {
+    tripReads,
+    poolMetrics: poolMetrics.snapshot
+};
@@ -0,0 +1,58 @@
+// Backfills the typed price (cents) and nights fields on trips written
+// before they existed, so the /api/trips range filters can see them. New
+// and updated trips get them from the schema hooks. Safe to re-run:
+//
+//   npm run migrate:trip-typed-fields
+
+require('dotenv').config();
+
+const mongoose = require('mongoose');
+const { dbURI } = require('../config');
+const Trip = require('../models/travlr');
+
+const BATCH_SIZE = 500;
+
+const migrate = async () => {
+    await mongoose.connect(dbURI, {
+        useNewUrlParser: true,
+        useCreateIndex: true,
+        useUnifiedTopology: true
+    });
+
+    const cursor = Trip
+        .find({ $or: [{ price: { $exists: false } }, { nights: { $exists: false } }] })
+        .select({ perPerson: 1, length: 1 })
+        .lean()
+        .cursor();
+
+    let batch = [];
+    let updated = 0;
+    const flush = async () => {
+        if (batch.length) {
+            const result = await Trip.bulkWrite(batch, { ordered: false });
+            updated += result.modifiedCount;
+            batch = [];
+        }
+    };
+
+    for await (const trip of cursor) {
+        const fields = Trip.typedFields(trip);
+        if (Object.keys(fields).length) {
+            batch.push({ updateOne: { filter: { _id: trip._id }, update: { $set: fields } } });
+        } else {
+            console.log(`Trip ${trip._id}: can't parse price "${trip.perPerson}" or length "${trip.length}"`);
+        }
+        if (batch.length >= BATCH_SIZE) {
+            await flush();
+        }
+    }
+    await flush();
+    console.log(`Backfilled price/nights on ${updated} trip(s)`);
+};
+
+migrate()
+    .catch(err => {
+        console.log('Migration failed:', err);
+        process.exitCode = 1;
+    })
+    .finally(() => mongoose.disconnect());
@@ -0,0 +1,56 @@
+// Replaces the plain index on trips.code with the unique index the schema
+// now declares. Run this once before deploying, since the app can't build
+// a unique index over existing duplicates:
+//
+//   npm run migrate:unique-trip-code
+//
+// If any code is used by more than one trip, the duplicates are listed and
+// nothing is changed; resolve them (e.g. through the admin app) and re-run.
+
+require('dotenv').config();
+
+const mongoose = require('mongoose');
+const { dbURI } = require('../config');
+const Trip = require('../models/travlr');
+
+const findDuplicates = () => Trip
+    .aggregate([
+        { $group: { _id: '$code', count: { $sum: 1 }, names: { $push: '$name' } } },
+        { $match: { count: { $gt: 1 } } },
+        { $sort: { _id: 1 } }
+    ])
+    .allowDiskUse(true)
+    .exec();
+
+const migrate = async () => {
+    await mongoose.connect(dbURI, {
+        useNewUrlParser: true,
+        useCreateIndex: true,
+        useUnifiedTopology: true,
+        autoIndex: false
+    });
+
+    const duplicates = await findDuplicates();
+    if (duplicates.length) {
+        console.log(`${duplicates.length} trip code(s) are not unique:`);
+        duplicates.forEach(({ _id, count, names }) => {
+            console.log(`  ${_id} (${count} trips: ${names.join(', ')})`);
+        });
+        return 1;
+    }
+
+    // drops the old non-unique code_1 index and builds the unique one
+    const dropped = await Trip.syncIndexes();
+    console.log(`Trip indexes synced${dropped.length ? `, dropped ${dropped.join(', ')}` : ''}`);
+    return 0;
+};
+
+migrate()
+    .then(code => {
+        process.exitCode = code;
+    })
+    .catch(err => {
+        console.log('Migration failed:', err);
+        process.exitCode = 1;
+    })
+    .finally(() => mongoose.disconnect());
@@ -3,16 +3,89 @@
 const mongoose = require('mongoose');
 // define the trip schema
 const tripSchema = new mongoose.Schema({
-    code: { type: String, required: true, index: true },
+    code: { type: String, required: true, unique: true }, // keyset paging key
     name: { type: String, required: true, index: true },
     length: { type: String, required: true },
     start: { type: Date, required: true },
     resort: { type: String, required: true },
     perPerson: { type: String, required: true },
     image: { type: String, required: true },
-    description: { type: String, required: true }
+    description: { type: String, required: true },
+    // typed copies of perPerson and length, derived on write, for range queries
+    price: { type: Number, min: 0 },  // per-person price in cents
+    nights: { type: Number, min: 0 }
 
 });
 
+// Parse the display strings ("799.00", "4 nights / 5 days") into the typed
+// fields; anything unparseable is left undefined
+const typedFields = ({ perPerson, length }) => {
+    const fields = {};
+    if (perPerson !== undefined && perPerson !== null) {
+        const price = parseFloat(String(perPerson).replace(/[^0-9.]/g, ''));
+        if (Number.isFinite(price)) {
+            fields.price = Math.round(price * 100);
+        }
+    }
+    if (length !== undefined && length !== null) {
+        const nights = /(\d+)\s*nights?/i.exec(String(length));
+        if (nights) {
+            fields.nights = parseInt(nights[1], 10);
+        }
+    }
+    return fields;
+};
+tripSchema.statics.typedFields = typedFields;
+
+// $set/$unset that bring the typed fields in line with the display strings
+// 'source' carries. A string that's present but unparseable ("Call for
+// price") unsets its typed copy, so range filters stop matching the old value.
+const typedUpdate = source => {
+    const parsed = typedFields(source);
+    const update = { $set: {}, $unset: {} };
+    [['perPerson', 'price'], ['length', 'nights']].forEach(([display, typed]) => {
+        if (source[display] === undefined || source[display] === null) {
+            return;
+        }
+        if (parsed[typed] !== undefined) {
+            update.$set[typed] = parsed[typed];
+        } else {
+            update.$unset[typed] = 1;
+        }
+    });
+    return update;
+};
+tripSchema.statics.typedUpdate = typedUpdate;
+
+tripSchema.pre('validate', function(next) {
+    const { $set, $unset } = typedUpdate(this);
+    this.set($set);
+    Object.keys($unset).forEach(field => this.set(field, undefined));
+    next();
+});
+
+tripSchema.pre('findOneAndUpdate', function(next) {
+    const update = this.getUpdate();
+    const fields = update.$set || update;
+    const { $set, $unset } = typedUpdate(fields);
+    Object.assign(fields, $set);
+    if (Object.keys($unset).length) {
+        update.$unset = Object.assign(update.$unset || {}, $unset);
+    }
+    next();
+});
+
+// range filters and sorts on /api/trips; code breaks ties for keyset paging
+tripSchema.index({ start: 1, price: 1 });
+tripSchema.index({ start: 1, code: 1 });
+tripSchema.index({ price: 1, code: 1 });
+tripSchema.index({ nights: 1, code: 1 });
+
+// full-text search over the public trip text, used by /api/trips/search
+tripSchema.index(
+    { name: 'text', resort: 'text', description: 'text' },
+    { name: 'trip_text', weights: { name: 10, resort: 5, description: 1 } }
+);
+
 //mongoose.model("trips", tripSchema):
 module.exports = mongoose.model("trips", tripSchema);
@@ -1,6 +1,7 @@
 const mongoose = require('mongoose');
 const crypto = require('crypto');
 const jwt = require('jsonwebtoken');
+const passwordHasher = require('../../services/passwordHasher');
 
 const userSchema = new mongoose.Schema({
     email: {
@@ -15,15 +16,17 @@ const userSchema = new mongoose.Schema({
     hash: String,
     salt: String
 });
+// Both hash on the bounded threadpool in passwordHasher and return promises
 userSchema.methods.setPassword = function(password) {
     this.salt = crypto.randomBytes(16).toString('hex');
-    this.hash = crypto.pbkdf2Sync(password, this.salt,
-        1000, 64, 'sha512').toString('hex');
+    return passwordHasher.hash(password, this.salt)
+        .then(key => {
+            this.hash = key.toString('hex');
+        });
 };
 userSchema.methods.validPassword = function(password) {
-    var hash = crypto.pbkdf2Sync(password,
-        this.salt, 1000, 64, 'sha512').toString('hex');
-    return this.hash === hash;
+    return passwordHasher.hash(password, this.salt || '')
+        .then(key => passwordHasher.matches(key, this.hash));
 };
 userSchema.methods.generateJwt = function () {
     const expiry = new Date();
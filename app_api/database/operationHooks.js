@@ -0,0 +1,32 @@
+// The Mongoose operations the metrics and tracing plugins instrument, wired
+// up in one place so both always cover the same set: queries,
+// aggregations and saves.
+
+const QUERY_OPS = ['find', 'findOne', 'findOneAndUpdate', 'findOneAndDelete', 'countDocuments',
+    'updateOne', 'updateMany', 'deleteOne', 'deleteMany'];
+
+// Hooks start(target, op, model) before every instrumented operation and
+// finish(target, op, model, err) after it; 'target' is the query, aggregate
+// or document, and 'err' is undefined on success
+const instrument = (schema, { start, finish }) => {
+    const hook = (op, modelOf) => {
+        schema.pre(op, function() {
+            start(this, op, modelOf(this));
+        });
+        schema.post(op, function() {
+            finish(this, op, modelOf(this));
+        });
+        schema.post(op, function(err, res, next) {
+            finish(this, op, modelOf(this), err);
+            next(err);
+        });
+    };
+    QUERY_OPS.forEach(op => hook(op, query => query.model));
+    hook('aggregate', aggregate => aggregate._model);
+    hook('save', doc => doc.constructor);
+};
+
+module.exports = {
+    QUERY_OPS,
+    instrument
+};
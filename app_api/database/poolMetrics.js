@@ -0,0 +1,69 @@
+// Connection pool metrics from the MongoDB driver's CMAP events: how many
+// connections are open and checked out, how many operations are waiting
+// for one, and how long they waited. Used to size DB_POOL_SIZE.
+
+const counters = {
+    open: 0,           // connections currently open
+    checkedOut: 0,     // connections currently lent to an operation
+    waitCount: 0,      // completed checkouts (successful or not)
+    waitTimeMs: 0,     // total time spent waiting for those checkouts
+    maxWaitTimeMs: 0,
+    checkOutFailures: 0
+};
+
+// Start times of checkouts still waiting, per server; the pool serves its
+// wait queue in order, so the oldest start belongs to the next checkout
+const waiting = new Map();
+
+const started = event => {
+    if (!waiting.has(event.address)) {
+        waiting.set(event.address, []);
+    }
+    waiting.get(event.address).push(Date.now());
+};
+
+const finished = event => {
+    const queue = waiting.get(event.address);
+    const start = queue && queue.shift();
+    if (start !== undefined) {
+        const waited = Date.now() - start;
+        counters.waitCount++;
+        counters.waitTimeMs += waited;
+        counters.maxWaitTimeMs = Math.max(counters.maxWaitTimeMs, waited);
+    }
+};
+
+const attached = new WeakSet();
+
+const attach = client => {
+    if (!client || attached.has(client)) {
+        return;
+    }
+    attached.add(client);
+    client.on('connectionCreated', () => counters.open++);
+    client.on('connectionClosed', () => counters.open--);
+    client.on('connectionCheckOutStarted', started);
+    client.on('connectionCheckedOut', event => {
+        counters.checkedOut++;
+        finished(event);
+    });
+    client.on('connectionCheckOutFailed', event => {
+        counters.checkOutFailures++;
+        finished(event);
+    });
+    client.on('connectionCheckedIn', () => counters.checkedOut--);
+    client.on('connectionPoolCleared', event => waiting.delete(event.address));
+};
+
+const snapshot = () => {
+    let waitQueueLength = 0;
+    waiting.forEach(queue => {
+        waitQueueLength += queue.length;
+    });
+    return Object.assign({ waitQueueLength }, counters);
+};
+
+module.exports = {
+    attach,
+    snapshot
+};
@@ -10,27 +10,40 @@ const auth = jwt({
     algorithms: ["HS256"],
 }); 
 
+const { resolveUser } = require('../services/principalCache');
+const { throttle } = require('../services/loginThrottle');
+
+// bulk trip writes carry a whole season of trips
+const bulkBody = express.json({ limit: '10mb' });
+
 const authController = require('../controllers/authentication');
 const tripsController = require('../controllers/trips');
 
 router
     .route('/login')
-    .post(authController.login);
+    .post(throttle, authController.login);
 
 router
     .route('/register')
-    .post(authController.register);
+    .post(throttle, authController.register);
 
 router
     .route('/trips')
     .get(tripsController.tripsList)
-    .post(auth, tripsController.tripsAddTrip);
+    .post(auth, resolveUser, tripsController.tripsAddTrip);
 
+router
+    .route('/trips/search')
+    .get(tripsController.tripsSearch);
+
+router
+    .route('/trips/bulk')
+    .post(auth, resolveUser, bulkBody, tripsController.tripsBulk);
 
 router
     .route('/trips/:tripCode')
     .get(tripsController.tripsFindCode)
-    .put(auth, tripsController.tripsUpdateTrip)
-    .delete (auth, tripsController.tripsDeleteTrip);
+    .put(auth, resolveUser, tripsController.tripsUpdateTrip)
+    .delete (auth, resolveUser, tripsController.tripsDeleteTrip);
 
 module.exports = router;
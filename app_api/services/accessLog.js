@@ -0,0 +1,66 @@
+// Structured JSON access log, one line per request, written through a
+// bufferedSink instead of morgan's synchronous per-request console writes.
+//   ACCESS_LOG=stdout | stderr | /path/to/file | off   (default stdout)
+//   ACCESS_LOG_STATIC_SAMPLE=0..1   share of successful static-file requests
+//                                   to log (default 0.1); each sampled line
+//                                   carries its sample rate for weighting
+
+const { createSink } = require('./bufferedSink');
+
+const destination = process.env.ACCESS_LOG || 'stdout';
+const parsedRate = parseFloat(process.env.ACCESS_LOG_STATIC_SAMPLE);
+const STATIC_SAMPLE = Number.isFinite(parsedRate) ? Math.min(1, Math.max(0, parsedRate)) : 0.1;
+
+const sink = destination === 'off' ? null : createSink(destination);
+
+const isStatic = (req, res) => !req.route && res.statusCode < 400;
+
+const accessLog = (req, res, next) => {
+    if (!sink) {
+        return next();
+    }
+    const start = process.hrtime.bigint();
+    const entry = aborted => {
+        const staticFile = isStatic(req, res);
+        const successful = res.statusCode < 300 || res.statusCode === 304;
+        if (staticFile && successful && !aborted && Math.random() >= STATIC_SAMPLE) {
+            return;
+        }
+        const line = {
+            time: new Date().toISOString(),
+            method: req.method,
+            requestId: req.id,
+            traceId: req.traceId,
+            url: req.originalUrl,
+            route: req.route ? req.baseUrl + req.route.path : (staticFile ? 'static' : null),
+            status: res.statusCode,
+            durationMs: Math.round(Number(process.hrtime.bigint() - start) / 1e4) / 100,
+            bytes: Number(res.getHeader('Content-Length')) || undefined,
+            ip: req.ip,
+            userAgent: req.get('User-Agent'),
+            referrer: req.get('Referer')
+        };
+        if (aborted) {
+            line.aborted = true;
+        }
+        if (staticFile && successful && !aborted) {
+            line.sampleRate = STATIC_SAMPLE;
+        }
+        sink.write(JSON.stringify(line));
+    };
+    res.on('finish', () => entry(false));
+    res.on('close', () => {
+        if (!res.writableFinished) {
+            entry(true);
+        }
+    });
+    next();
+};
+
+// Lines dropped under backpressure since startup
+const dropped = () => (sink ? sink.dropped() : 0);
+
+module.exports = {
+    accessLog,
+    dropped
+};
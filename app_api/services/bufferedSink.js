@@ -0,0 +1,82 @@
+// Line-oriented log sink that batches writes. Lines collect in memory and
+// go out in one write per FLUSH_INTERVAL_MS or FLUSH_BYTES, whichever comes
+// first. While the destination is applying backpressure (write() returned
+// false and 'drain' hasn't fired) lines keep buffering up to MAX_BYTES;
+// beyond that they are dropped and counted rather than held without bound.
+
+const fs = require('fs');
+
+const FLUSH_INTERVAL_MS = 1000;
+const FLUSH_BYTES = 64 * 1024;
+const MAX_BYTES = 4 * 1024 * 1024;
+
+// 'destination' is 'stdout', 'stderr' or a file path (appended to)
+const createSink = destination => {
+    const stream = destination === 'stdout' ? process.stdout
+        : destination === 'stderr' ? process.stderr
+            : fs.createWriteStream(destination, { flags: 'a' });
+
+    let lines = [];
+    let bytes = 0;
+    let blocked = false;
+    let dropped = 0;        // since the last 'log_dropped' marker
+    let droppedTotal = 0;
+
+    const flush = () => {
+        if (blocked || !lines.length) {
+            return;
+        }
+        if (dropped) {
+            lines.push(JSON.stringify({ time: new Date().toISOString(), type: 'log_dropped', count: dropped }));
+            dropped = 0;
+        }
+        const chunk = lines.join('\n') + '\n';
+        lines = [];
+        bytes = 0;
+        if (!stream.write(chunk)) {
+            blocked = true;
+            stream.once('drain', () => {
+                blocked = false;
+                if (bytes >= FLUSH_BYTES) {
+                    flush();
+                }
+            });
+        }
+    };
+
+    const write = line => {
+        if (bytes + line.length > MAX_BYTES) {
+            dropped++;
+            droppedTotal++;
+            return;
+        }
+        lines.push(line);
+        bytes += line.length + 1;
+        if (bytes >= FLUSH_BYTES) {
+            flush();
+        }
+    };
+
+    setInterval(flush, FLUSH_INTERVAL_MS).unref();
+
+    // last-chance synchronous write of whatever is still buffered
+    process.on('exit', () => {
+        if (lines.length && typeof stream.fd === 'number') {
+            try {
+                fs.writeSync(stream.fd, lines.join('\n') + '\n');
+            } catch (err) {
+                // nothing useful left to do with it at exit
+            }
+        }
+    });
+
+    return {
+        write,
+        flush,
+        dropped: () => droppedTotal
+    };
+};
+
+module.exports = {
+    createSink
+};
@@ -0,0 +1,79 @@
+// Admission control for /api/login and /api/register. Password hashing is
+// deliberately expensive, so requests are rejected with 429 before any
+// hashing work when
+//   - the client IP or the target account has run out of tokens in its
+//     bucket, or
+//   - the password hasher is already saturated (running + queued).
+// Buckets live in memory, per process; idle full buckets are swept.
+// Behind a proxy, set Express 'trust proxy' so req.ip is the client's.
+
+const passwordHasher = require('./passwordHasher');
+
+const env = (name, fallback) => parseFloat(process.env[name]) || fallback;
+
+const limits = {
+    ip: { capacity: env('LOGIN_IP_BURST', 20), perSecond: env('LOGIN_IP_RATE', 1 / 3) },
+    account: { capacity: env('LOGIN_ACCOUNT_BURST', 5), perSecond: env('LOGIN_ACCOUNT_RATE', 1 / 12) }
+};
+const SWEEP_INTERVAL = 60 * 1000;
+
+const buckets = {
+    ip: new Map(),
+    account: new Map()
+};
+
+// Current bucket for 'key', refilled for the time since it was last seen
+const bucketFor = (kind, key, now) => {
+    const { capacity, perSecond } = limits[kind];
+    const bucket = buckets[kind].get(key) || { tokens: capacity, updated: now };
+    bucket.tokens = Math.min(capacity, bucket.tokens + (now - bucket.updated) / 1000 * perSecond);
+    bucket.updated = now;
+    buckets[kind].set(key, bucket);
+    return bucket;
+};
+
+// Seconds until 'bucket' holds a whole token again
+const retryAfter = (kind, bucket) => Math.ceil((1 - bucket.tokens) / limits[kind].perSecond);
+
+const tooMany = (res, seconds, message) => res
+    .status(429)
+    .set('Retry-After', String(Math.max(1, seconds)))
+    .json({ "message": message });
+
+const throttle = (req, res, next) => {
+    const { inFlight, queued, maxInFlight, maxQueued } = passwordHasher.stats();
+    if (inFlight + queued >= maxInFlight + maxQueued) {
+        return tooMany(res, 1, 'Server is busy, try again shortly');
+    }
+
+    const now = Date.now();
+    const checks = [['ip', req.ip]];
+    if (req.body && typeof req.body.email === 'string') {
+        checks.push(['account', req.body.email.trim().toLowerCase()]);
+    }
+    const held = checks.map(([kind, key]) => [kind, bucketFor(kind, key, now)]);
+    const empty = held.find(([, bucket]) => bucket.tokens < 1);
+    if (empty) {
+        return tooMany(res, retryAfter(...empty), 'Too many attempts, try again later');
+    }
+    held.forEach(([, bucket]) => {
+        bucket.tokens -= 1;
+    });
+    next();
+};
+
+// Drop buckets that have refilled completely; they hold no state worth keeping
+setInterval(() => {
+    const now = Date.now();
+    Object.keys(buckets).forEach(kind => {
+        buckets[kind].forEach((bucket, key) => {
+            if (bucketFor(kind, key, now).tokens >= limits[kind].capacity) {
+                buckets[kind].delete(key);
+            }
+        });
+    });
+}, SWEEP_INTERVAL).unref();
+
+module.exports = {
+    throttle
+};
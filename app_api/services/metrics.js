@@ -0,0 +1,151 @@
+// Prometheus metrics served at /metrics:
+//   http_request_duration_seconds   per Express route (api routes, /travel, static)
+//   mongoose_operation_duration_seconds   per model and operation
+//   mongodb_pool_*                  connection pool gauges from poolMetrics
+//   password_hash_*                 passwordHasher load
+//   access_log_dropped_total        access log lines shed under backpressure
+// plus prom-client's process defaults: event loop lag, GC pause durations,
+// heap spaces and usage. Latency histograms use exponential (HDR-style)
+// buckets from 0.5 ms to 16 s; recording is an hrtime read and a bucket
+// increment, cheap enough to leave on in production.
+
+const promClient = require('prom-client');
+const passwordHasher = require('./passwordHasher');
+const accessLog = require('./accessLog');
+const operationHooks = require('../database/operationHooks');
+
+const register = promClient.register;
+const LATENCY_BUCKETS = promClient.exponentialBuckets(0.0005, 2, 16);
+
+promClient.collectDefaultMetrics({ register, eventLoopMonitoringPrecision: 10 });
+
+const httpDuration = new promClient.Histogram({
+    name: 'http_request_duration_seconds',
+    help: 'HTTP request latency by route',
+    labelNames: ['method', 'route', 'status_code'],
+    buckets: LATENCY_BUCKETS
+});
+
+const mongooseDuration = new promClient.Histogram({
+    name: 'mongoose_operation_duration_seconds',
+    help: 'Mongoose operation latency by model and operation',
+    labelNames: ['model', 'op'],
+    buckets: LATENCY_BUCKETS
+});
+
+const seconds = start => Number(process.hrtime.bigint() - start) / 1e9;
+
+// Route template rather than the raw URL, so label cardinality stays fixed
+const routeOf = (req, res) => {
+    if (req.route) {
+        return req.baseUrl + req.route.path;
+    }
+    return res.statusCode < 400 ? 'static' : 'unmatched';
+};
+
+// Express middleware timing every request through to 'finish'
+const httpMetrics = (req, res, next) => {
+    const start = process.hrtime.bigint();
+    res.on('finish', () => {
+        httpDuration.observe({
+            method: req.method,
+            route: routeOf(req, res),
+            status_code: res.statusCode
+        }, seconds(start));
+    });
+    next();
+};
+
+// Mongoose plugin timing queries, aggregations and saves (failed ones
+// included); register it with mongoose.plugin() before any model is compiled
+const mongoosePlugin = schema => operationHooks.instrument(schema, {
+    start: target => {
+        target._metricsStart = process.hrtime.bigint();
+    },
+    finish: (target, op, model) => {
+        if (target._metricsStart !== undefined) {
+            mongooseDuration.observe({ model: model.modelName, op }, seconds(target._metricsStart));
+            target._metricsStart = undefined;
+        }
+    }
+});
+
+// Gauges read from 'snapshot' (poolMetrics.snapshot) at scrape time
+const registerPoolMetrics = snapshot => {
+    const gauges = {
+        open: 'Open connections',
+        checkedOut: 'Connections lent to an operation',
+        waitQueueLength: 'Operations waiting for a connection'
+    };
+    Object.entries(gauges).forEach(([field, help]) => {
+        new promClient.Gauge({
+            name: `mongodb_pool_${field.replace(/[A-Z]/g, c => '_' + c.toLowerCase())}`,
+            help,
+            collect() {
+                this.set(snapshot()[field]);
+            }
+        });
+    });
+    new promClient.Counter({
+        name: 'mongodb_pool_wait_seconds_total',
+        help: 'Total time spent waiting for a connection',
+        collect() {
+            this.reset();
+            this.inc(snapshot().waitTimeMs / 1000);
+        }
+    });
+    new promClient.Counter({
+        name: 'mongodb_pool_checkouts_total',
+        help: 'Completed connection checkouts',
+        collect() {
+            this.reset();
+            this.inc(snapshot().waitCount);
+        }
+    });
+};
+
+new promClient.Gauge({
+    name: 'password_hash_in_flight',
+    help: 'Password hashes running on the threadpool',
+    collect() {
+        this.set(passwordHasher.stats().inFlight);
+    }
+});
+new promClient.Gauge({
+    name: 'password_hash_queued',
+    help: 'Password hashes waiting for a slot',
+    collect() {
+        this.set(passwordHasher.stats().queued);
+    }
+});
+
+new promClient.Counter({
+    name: 'access_log_dropped_total',
+    help: 'Access log lines dropped while the log destination was backed up',
+    collect() {
+        this.reset();
+        this.inc(accessLog.dropped());
+    }
+});
+
+// GET /metrics - Prometheus text exposition
+const endpoint = (req, res) => {
+    register.metrics()
+        .then(body => {
+            res
+                .status(200)
+                .type(register.contentType)
+                .send(body);
+        }, err => {
+            res
+                .status(500)
+                .send(err.message);
+        });
+};
+
+module.exports = {
+    httpMetrics,
+    mongoosePlugin,
+    registerPoolMetrics,
+    endpoint
+};
@@ -0,0 +1,55 @@
+// PBKDF2 password hashing off the event loop. crypto.pbkdf2 runs on the
+// libuv threadpool; this module bounds how many hashes may occupy it at
+// once (leaving threads free for fs, dns and zlib work) and how many may
+// wait, so a login storm gets 429s instead of an ever-growing backlog.
+
+const crypto = require('crypto');
+
+const ITERATIONS = 1000;
+const KEY_LENGTH = 64;
+const DIGEST = 'sha512';
+
+const threadpoolSize = parseInt(process.env.UV_THREADPOOL_SIZE, 10) || 4;
+const MAX_IN_FLIGHT = parseInt(process.env.HASH_CONCURRENCY, 10) || Math.max(1, threadpoolSize - 2);
+const MAX_QUEUED = parseInt(process.env.HASH_QUEUE_LIMIT, 10) || 200;
+
+let inFlight = 0;
+const queue = [];
+
+const next = () => {
+    while (inFlight < MAX_IN_FLIGHT && queue.length) {
+        const { password, salt, resolve, reject } = queue.shift();
+        inFlight++;
+        crypto.pbkdf2(password, salt, ITERATIONS, KEY_LENGTH, DIGEST, (err, key) => {
+            inFlight--;
+            next();
+            return err ? reject(err) : resolve(key);
+        });
+    }
+};
+
+// Derived key for 'password' and 'salt'; rejects with code EHASHQUEUEFULL
+// when the queue is already at its limit
+const hash = (password, salt) => new Promise((resolve, reject) => {
+    if (queue.length >= MAX_QUEUED) {
+        const err = new Error('Too many password checks in progress, try again shortly');
+        err.code = 'EHASHQUEUEFULL';
+        return reject(err);
+    }
+    queue.push({ password, salt, resolve, reject });
+    next();
+});
+
+// Constant-time comparison of a derived key against a stored hex hash
+const matches = (key, storedHex) => {
+    const stored = Buffer.from(storedHex || '', 'hex');
+    return stored.length === key.length && crypto.timingSafeEqual(stored, key);
+};
+
+const stats = () => ({ inFlight, queued: queue.length, maxInFlight: MAX_IN_FLIGHT, maxQueued: MAX_QUEUED });
+
+module.exports = {
+    hash,
+    matches,
+    stats
+};
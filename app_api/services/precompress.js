@@ -0,0 +1,81 @@
+// Compressed copies of cached response bodies. Each body is compressed at
+// most once per encoding (on the libuv threadpool), and the bytes live as
+// long as the cache entry that owns them, i.e. until the catalog changes.
+
+const util = require('util');
+const zlib = require('zlib');
+
+const THRESHOLD = 1024; // smaller bodies aren't worth a Content-Encoding
+
+const compressors = {
+    br: body => util.promisify(zlib.brotliCompress)(body, {
+        params: {
+            [zlib.constants.BROTLI_PARAM_QUALITY]: 9,
+            [zlib.constants.BROTLI_PARAM_SIZE_HINT]: Buffer.byteLength(body)
+        }
+    }),
+    gzip: body => util.promisify(zlib.gzip)(body, { level: 9 })
+};
+
+// Best encoding the client accepts for 'entry', or 'identity'
+const negotiate = (req, entry) => {
+    if (entry.body.length < THRESHOLD) {
+        return 'identity';
+    }
+    return req.acceptsEncodings(['br', 'gzip', 'identity']) || 'identity';
+};
+
+// Compressed body for 'entry' in 'encoding', memoized on the entry
+const encode = (entry, encoding) => {
+    entry.encoded = entry.encoded || {};
+    if (!entry.encoded[encoding]) {
+        entry.encoded[encoding] = compressors[encoding](entry.body)
+            .catch(err => {
+                delete entry.encoded[encoding];
+                throw err;
+            });
+    }
+    return entry.encoded[encoding];
+};
+
+// Send a cached entry as 'type', compressed once per entry, or 304 if the
+// client's copy is current
+const send = async (req, res, entry, type) => {
+    const encoding = negotiate(req, entry);
+    res.set('Cache-Control', 'no-cache');
+    res.vary('Accept-Encoding');
+    // each encoding is its own representation, so it needs its own ETag
+    res.set('ETag', encoding === 'identity' ? entry.etag : entry.etag.replace(/"$/, `-${encoding}"`));
+    if (req.fresh) {
+        return res
+            .status(304)
+            .end();
+    }
+    if (encoding === 'identity') {
+        return res
+            .status(200)
+            .type(type)
+            .send(entry.body);
+    }
+    try {
+        const body = await encode(entry, encoding);
+        return res
+            .status(200)
+            .type(type)
+            .set('Content-Encoding', encoding)
+            .send(body);
+    } catch (err) {
+        console.log('Response compression error:', err);
+        res.removeHeader('ETag');
+        return res
+            .status(200)
+            .type(type)
+            .send(entry.body);
+    }
+};
+
+module.exports = {
+    negotiate,
+    encode,
+    send
+};
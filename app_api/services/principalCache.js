@@ -0,0 +1,73 @@
+// Resolves the user behind a verified JWT once per request, from a small
+// TTL cache keyed by the token subject. express-jwt has already checked the
+// signature, so all that's left is confirming the account still exists;
+// that only needs MongoDB once per TTL per user instead of once per write.
+// Concurrent misses for the same subject share a single lookup.
+
+const mongoose = require('mongoose');
+const User = mongoose.model('users');
+
+const TTL_MS = parseInt(process.env.PRINCIPAL_TTL_MS, 10) || 60 * 1000;
+const MAX_ENTRIES = 10000;
+
+const cache = new Map(); // subject -> { user, expires }
+const pending = new Map(); // subject -> Promise<user | null>
+
+const lookup = (subject, email) => {
+    if (!pending.has(subject)) {
+        const promise = User
+            .findOne({ email }, { name: 1, email: 1 })
+            .lean()
+            .exec()
+            .then(user => {
+                if (user) {
+                    if (cache.size >= MAX_ENTRIES) {
+                        cache.delete(cache.keys().next().value); // oldest first
+                    }
+                    cache.set(subject, { user, expires: Date.now() + TTL_MS });
+                }
+                return user;
+            })
+            .finally(() => pending.delete(subject));
+        pending.set(subject, promise);
+    }
+    return pending.get(subject);
+};
+
+const resolve = payload => {
+    const subject = String(payload._id || payload.email);
+    const cached = cache.get(subject);
+    if (cached && cached.expires > Date.now()) {
+        return Promise.resolve(cached.user);
+    }
+    cache.delete(subject);
+    return lookup(subject, payload.email);
+};
+
+// Express middleware for routes behind 'auth': sets req.user or answers 404
+const resolveUser = (req, res, next) => {
+    if (!req.payload || !req.payload.email) {
+        return res
+            .status(401)
+            .json({ "message": "User not authorized" });
+    }
+    resolve(req.payload)
+        .then(user => {
+            if (!user) {
+                return res
+                    .status(404)
+                    .json({ "message": "User not found" });
+            }
+            req.user = user;
+            next();
+        }, err => {
+            console.log(err);
+            return res
+                .status(404)
+                .json(err);
+        });
+};
+
+module.exports = {
+    resolveUser
+};
@@ -0,0 +1,106 @@
+// Liveness and readiness for the process, plus a gate that holds requests
+// arriving before the app is ready. Ready means MongoDB is connected and
+// the trip catalog cache has been warmed at least once. Held requests are
+// released the moment that happens; the queue is bounded in both length and
+// wait time, so a cold start answers 503 + Retry-After rather than piling up.
+// The gate only covers startup: once the app has been ready it stays open,
+// so a later database outage doesn't hold requests the warm trip cache (or
+// the pages' stale catalog) can still answer. /readyz keeps reporting the
+// live state.
+
+const cluster = require('cluster');
+const { AsyncResource } = require('async_hooks');
+const mongoose = require('mongoose');
+const db = require('../database/db');
+const tripCache = require('./tripCache');
+
+const MAX_WAITING = parseInt(process.env.READY_QUEUE_LIMIT, 10) || 100;
+const MAX_WAIT_MS = parseInt(process.env.READY_WAIT_MS, 10) || 10 * 1000;
+const CONNECTION_STATES = ['disconnected', 'connected', 'connecting', 'disconnecting'];
+
+const waiting = new Set();
+let opened = false; // set the first time the app is ready, never cleared
+
+const isReady = () => mongoose.connection.readyState === 1 && tripCache.getVersion() > 0;
+
+const unavailable = res => res
+    .status(503)
+    .set('Retry-After', '1')
+    .json({ "message": "Service is starting up, try again shortly" });
+
+const release = () => {
+    if (!isReady()) {
+        return;
+    }
+    if (!opened && cluster.isWorker) {
+        // lets bin/www's rolling restart retire the worker this one replaces
+        process.send({ ready: true });
+    }
+    opened = true;
+    waiting.forEach(waiter => waiter.release());
+};
+
+mongoose.connection.on('connected', release);
+mongoose.connection.on('reconnected', release);
+tripCache.events.on('load', release);
+
+// Express middleware: pass through once the app has been ready, otherwise
+// wait in the queue
+const gate = (req, res, next) => {
+    if (opened) {
+        return next();
+    }
+    if (isReady()) {
+        release();
+        return next();
+    }
+    if (waiting.size >= MAX_WAITING) {
+        return unavailable(res);
+    }
+    // released from a connection event, so carry the request's trace context
+    const resume = AsyncResource.bind(next);
+    const waiter = {
+        release: () => {
+            done();
+            resume();
+        }
+    };
+    const timer = setTimeout(() => {
+        done();
+        unavailable(res);
+    }, MAX_WAIT_MS);
+    const done = () => {
+        clearTimeout(timer);
+        waiting.delete(waiter);
+        res.removeListener('close', done);
+    };
+    res.on('close', done);
+    waiting.add(waiter);
+};
+
+// GET /healthz - the process is up and its event loop is turning
+const liveness = (req, res) => {
+    res
+        .status(200)
+        .json({ "status": "ok" });
+};
+
+// GET /readyz - 200 once requests can be served, 503 until then
+const readiness = (req, res) => {
+    res
+        .status(isReady() ? 200 : 503)
+        .json({
+            "status": isReady() ? "ready" : "starting",
+            "database": CONNECTION_STATES[mongoose.connection.readyState] || 'unknown',
+            "tripCache": tripCache.isWarm() ? "warm" : "cold",
+            "waiting": waiting.size,
+            "pool": db.poolMetrics()
+        });
+};
+
+module.exports = {
+    isReady,
+    gate,
+    liveness,
+    readiness
+};
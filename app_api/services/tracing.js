@@ -0,0 +1,180 @@
+// Request-scoped trace context. Every request runs inside an
+// AsyncLocalStorage context carrying its request ID and W3C trace context
+// (continued from an incoming traceparent header, or started fresh), so
+// Mongoose queries and view rendering can open child spans without the
+// request being passed down to them.
+//   TRACE_EXPORT=/path/to/file   append finished spans as OTLP/JSON lines
+//                                (one ExportTraceServiceRequest per line,
+//                                the OpenTelemetry collector file format);
+//                                unset or 'off' keeps IDs but records nothing
+
+const crypto = require('crypto');
+const { AsyncLocalStorage } = require('async_hooks');
+const { createSink } = require('./bufferedSink');
+const operationHooks = require('../database/operationHooks');
+
+const destination = process.env.TRACE_EXPORT || 'off';
+const sink = destination === 'off' ? null : createSink(destination);
+
+const BATCH_INTERVAL_MS = 1000;
+const BATCH_SIZE = 512;
+
+const KIND = { internal: 1, server: 2, client: 3 };
+const STATUS = { ok: 1, error: 2 };
+
+const storage = new AsyncLocalStorage();
+
+// wall-clock nanoseconds from the monotonic clock
+const EPOCH_OFFSET = BigInt(Date.now()) * 1000000n - process.hrtime.bigint();
+const nowNanos = () => process.hrtime.bigint() + EPOCH_OFFSET;
+
+const randomHex = bytes => crypto.randomBytes(bytes).toString('hex');
+
+const TRACEPARENT = /^00-([0-9a-f]{32})-([0-9a-f]{16})-[0-9a-f]{2}$/;
+const REQUEST_ID = /^[\w.:-]{1,128}$/;
+
+// OTLP attribute list from a plain object, skipping empty values
+const toAttributes = attributes => Object.entries(attributes)
+    .filter(([, value]) => value !== undefined && value !== null)
+    .map(([key, value]) => ({
+        key,
+        value: typeof value === 'number'
+            ? (Number.isInteger(value) ? { intValue: String(value) } : { doubleValue: value })
+            : typeof value === 'boolean' ? { boolValue: value } : { stringValue: String(value) }
+    }));
+
+let batch = [];
+
+const exportBatch = () => {
+    if (!batch.length) {
+        return;
+    }
+    sink.write(JSON.stringify({
+        resourceSpans: [{
+            resource: { attributes: toAttributes({ 'service.name': 'travlr', 'process.pid': process.pid }) },
+            scopeSpans: [{ scope: { name: 'travlr' }, spans: batch }]
+        }]
+    }));
+    batch = [];
+};
+
+if (sink) {
+    setInterval(exportBatch, BATCH_INTERVAL_MS).unref();
+    // ahead of the sink's own exit handler, so the last batch reaches it
+    process.prependListener('exit', exportBatch);
+}
+
+const createSpan = (context, name, kind, attributes) => {
+    const span = {
+        traceId: context.traceId,
+        spanId: randomHex(8),
+        parentSpanId: context.spanId,
+        name,
+        start: nowNanos(),
+        attributes: Object.assign({}, attributes),
+        ended: false
+    };
+    // end(extraAttributes, error) - later calls are ignored
+    span.end = (extra, err) => {
+        if (span.ended) {
+            return;
+        }
+        span.ended = true;
+        if (!sink) {
+            return;
+        }
+        Object.assign(span.attributes, extra);
+        batch.push({
+            traceId: span.traceId,
+            spanId: span.spanId,
+            parentSpanId: span.parentSpanId || undefined,
+            name: span.name,
+            kind,
+            startTimeUnixNano: String(span.start),
+            endTimeUnixNano: String(nowNanos()),
+            attributes: toAttributes(span.attributes),
+            status: err ? { code: STATUS.error, message: err.message || String(err) } : { code: STATUS.ok }
+        });
+        if (batch.length >= BATCH_SIZE) {
+            exportBatch();
+        }
+    };
+    return span;
+};
+
+// { requestId, traceId, spanId } of the current request, or undefined
+const current = () => storage.getStore();
+
+// Starts a child of the current span; outside a request it returns a no-op
+// span so callers needn't check
+const startSpan = (name, attributes, kind = 'internal') => {
+    const context = current();
+    if (!context) {
+        return { end: () => {} };
+    }
+    return createSpan(context, name, KIND[kind], attributes);
+};
+
+// Express middleware: opens the server span and runs the rest of the
+// request inside its context. Sets req.id and the X-Request-Id header.
+const middleware = (req, res, next) => {
+    const parent = TRACEPARENT.exec(req.get('traceparent') || '');
+    const incomingId = req.get('X-Request-Id');
+    const requestId = incomingId && REQUEST_ID.test(incomingId) ? incomingId : crypto.randomUUID();
+    const root = {
+        traceId: parent ? parent[1] : randomHex(16),
+        spanId: parent ? parent[2] : undefined
+    };
+    const span = createSpan(root, `${req.method} ${req.path}`, KIND.server, {
+        'http.method': req.method,
+        'http.target': req.originalUrl,
+        'request.id': requestId
+    });
+
+    req.id = requestId;
+    req.traceId = span.traceId;
+    res.set('X-Request-Id', requestId);
+
+    const end = () => {
+        const route = req.route ? req.baseUrl + req.route.path : undefined;
+        if (route) {
+            span.name = `${req.method} ${route}`;
+        }
+        span.end({
+            'http.route': route,
+            'http.status_code': res.statusCode,
+            'http.aborted': res.writableFinished ? undefined : true
+        }, res.statusCode >= 500 ? new Error(`HTTP ${res.statusCode}`) : undefined);
+    };
+    res.on('finish', end);
+    res.on('close', end);
+
+    storage.run({ requestId, traceId: span.traceId, spanId: span.spanId }, next);
+};
+
+// Mongoose plugin opening a client span per query, aggregation and save
+// made while handling a request; register it with mongoose.plugin()
+const mongoosePlugin = schema => operationHooks.instrument(schema, {
+    start: (target, op, model) => {
+        if (current()) {
+            target._traceSpan = startSpan(`mongodb.${op}`, {
+                'db.system': 'mongodb',
+                'db.operation': op,
+                'db.mongodb.collection': model.collection.name
+            }, 'client');
+        }
+    },
+    finish: (target, op, model, err) => {
+        if (target._traceSpan) {
+            target._traceSpan.end(undefined, err);
+            target._traceSpan = undefined;
+        }
+    }
+});
+
+module.exports = {
+    current,
+    startSpan,
+    middleware,
+    mongoosePlugin
+};
@@ -0,0 +1,130 @@
+// Translates the body of POST /api/trips/bulk into one Trip.bulkWrite and
+// maps the outcome back onto each requested operation.
+//   { "ordered": true,
+//     "operations": [
+//       { "op": "insert", "trip": { ...all trip fields } },
+//       { "op": "update", "code": "GALR210214", "trip": { ...fields to change } },
+//       { "op": "delete", "code": "GALR210214" } ] }
+// Every operation is validated before anything is written, so a batch is
+// either rejected whole with 400 or sent to MongoDB in a single round trip.
+
+const mongoose = require('mongoose');
+const Trip = mongoose.model('trips');
+
+const MAX_OPERATIONS = 1000;
+const TRIP_FIELDS = ['code', 'name', 'length', 'start', 'resort', 'perPerson', 'image', 'description'];
+
+const pickFields = trip => {
+    const fields = {};
+    TRIP_FIELDS.forEach(field => {
+        if (trip[field] !== undefined) {
+            fields[field] = trip[field];
+        }
+    });
+    return fields;
+};
+
+// Validated bulkWrite model for one operation, or { error }
+const toWriteModel = operation => {
+    const { op, code, trip } = operation || {};
+    if (op === 'insert') {
+        const doc = new Trip(pickFields(trip || {}));
+        doc.set(Trip.typedUpdate(doc).$set); // validateSync() skips the pre-validate hook
+        const invalid = doc.validateSync();
+        if (invalid) {
+            return { error: invalid.message };
+        }
+        return { code: doc.code, model: { insertOne: { document: doc.toObject() } } };
+    }
+    if (typeof code !== 'string' || !code) {
+        return { error: 'code is required' };
+    }
+    if (op === 'update') {
+        const fields = pickFields(trip || {});
+        if (!Object.keys(fields).length) {
+            return { error: 'trip must contain fields to update' };
+        }
+        const doc = new Trip(fields);
+        const invalid = doc.validateSync(Object.keys(fields));
+        if (invalid) {
+            return { error: invalid.message };
+        }
+        const typed = Trip.typedUpdate(fields);
+        const update = { $set: Object.assign(doc.toObject({ depopulate: true }), typed.$set) };
+        delete update.$set._id;
+        if (Object.keys(typed.$unset).length) {
+            update.$unset = typed.$unset;
+        }
+        return { code, model: { updateOne: { filter: { code }, update } } };
+    }
+    if (op === 'delete') {
+        return { code, model: { deleteOne: { filter: { code } } } };
+    }
+    return { error: 'op must be insert, update or delete' };
+};
+
+// Returns { ordered, operations: [{ op, code, model }] } or { error, errors }
+const parse = body => {
+    const operations = body && body.operations;
+    if (!Array.isArray(operations) || !operations.length || operations.length > MAX_OPERATIONS) {
+        return { error: `operations must list 1 to ${MAX_OPERATIONS} operations` };
+    }
+    const parsed = operations.map(toWriteModel);
+    const errors = parsed
+        .map((result, index) => result.error ? { index, message: result.error } : null)
+        .filter(Boolean);
+    if (errors.length) {
+        return { error: 'invalid operations, nothing was written', errors };
+    }
+    return {
+        ordered: body.ordered !== false,
+        operations: parsed.map((result, index) => ({ op: operations[index].op, ...result }))
+    };
+};
+
+// Replays the batch against the codes that existed beforehand, so updates
+// and deletes of unknown codes can be reported per operation
+const expectedMatches = (operations, existingCodes) => {
+    const codes = new Set(existingCodes);
+    return operations.map(({ op, code, model }) => {
+        if (op === 'insert') {
+            codes.add(code);
+            return true;
+        }
+        const found = codes.has(code);
+        if (op === 'delete') {
+            codes.delete(code);
+        } else if (found && model.updateOne.update.$set.code !== undefined) {
+            codes.delete(code);
+            codes.add(model.updateOne.update.$set.code);
+        }
+        return found;
+    });
+};
+
+// Per-operation results from the bulkWrite outcome; 'writeErrors' come from
+// a BulkWriteError, and an ordered batch stops at its first failure
+const toResults = ({ ordered, operations }, found, writeErrors) => {
+    const failed = new Map(writeErrors.map(err => [err.index, err.errmsg]));
+    const firstFailure = writeErrors.length ? Math.min(...writeErrors.map(err => err.index)) : Infinity;
+    return operations.map(({ op, code }, index) => {
+        const result = { index, op, code };
+        if (failed.has(index)) {
+            result.status = 'error';
+            result.message = failed.get(index);
+        } else if (ordered && index > firstFailure) {
+            result.status = 'skipped';
+        } else if (!found[index]) {
+            result.status = 'notFound';
+        } else {
+            result.status = 'ok';
+        }
+        return result;
+    });
+};
+
+module.exports = {
+    parse,
+    expectedMatches,
+    toResults
+};
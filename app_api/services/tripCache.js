@@ -0,0 +1,200 @@
+// In-process cache of the trip catalog. Warmed from the 'trips' model once
+// Mongoose connects, then reloaded whenever the collection changes, either
+// from a MongoDB change stream or from the API write controllers.
+
+const cluster = require('cluster');
+const crypto = require('crypto');
+const EventEmitter = require('events');
+const mongoose = require('mongoose');
+const Trip = mongoose.model('trips');
+
+let trips = null;        // catalog in collection order, null until warm
+let byCode = new Map();
+let listEntry = null;    // serialized catalog and its ETag
+let codeEntries = new Map();
+let version = 0;         // bumped on every successful load
+let generation = 0;      // bumped on every invalidation, guards stale loads
+let loading = null;
+let changeStream = null;
+
+const INVALIDATE = 'trips:invalidate';
+const RETRY_MIN_MS = 250;
+const RETRY_MAX_MS = 30 * 1000;
+
+let retryTimer = null;
+let retryAttempt = 0;
+
+// 'load' after every successful (re)load, 'invalidate' when a copy is dropped
+const events = new EventEmitter();
+
+// Serialize a response body once and tag it with a strong ETag
+const toEntry = value => {
+    const body = JSON.stringify(value);
+    const hash = crypto.createHash('sha1').update(body).digest('base64');
+    return { body, etag: `"${hash}"` };
+};
+
+const load = () => {
+    if (loading) {
+        return loading;
+    }
+    const loadGeneration = generation;
+    // always from the primary: a reload after a write must not cache a
+    // lagging secondary's view until the next change
+    loading = Trip
+        .find({})
+        .lean()
+        .exec()
+        .then(docs => {
+            loading = null;
+            if (loadGeneration !== generation) {
+                // a write landed while we were reading, go again
+                return load();
+            }
+            trips = docs;
+            byCode = new Map(docs.map(trip => [trip.code, trip]));
+            listEntry = toEntry(docs);
+            codeEntries = new Map();
+            retryAttempt = 0;
+            version++;
+            events.emit('load', version);
+            return trips;
+        })
+        .catch(err => {
+            loading = null;
+            console.log('Trip cache load error:', err);
+            scheduleRetry();
+            throw err;
+        });
+    return loading;
+};
+
+// A failed load leaves the cache cold with nothing bound to reload it: a
+// standalone server has no change stream, and before the first load the
+// readiness gate keeps writes out. Retry with jittered exponential backoff,
+// as db.js does for the connection, until a load succeeds.
+const scheduleRetry = () => {
+    if (retryTimer || trips !== null) {
+        return;
+    }
+    const delay = Math.min(RETRY_MAX_MS, RETRY_MIN_MS * 2 ** retryAttempt++);
+    const jittered = Math.round(delay / 2 + Math.random() * delay / 2);
+    console.log(`Retrying trip cache load in ${jittered} ms`);
+    retryTimer = setTimeout(() => {
+        retryTimer = null;
+        if (trips === null) {
+            load().catch(() => null);
+        }
+    }, jittered);
+    retryTimer.unref();
+};
+
+// Drop the cached catalog so readers fall through to MongoDB, then reload
+const invalidateLocal = () => {
+    generation++;
+    trips = null;
+    byCode = new Map();
+    listEntry = null;
+    codeEntries = new Map();
+    events.emit('invalidate');
+    if (loading) {
+        // the in-flight load sees the new generation and retries itself
+        return loading;
+    }
+    return load().catch(() => null);
+};
+
+// Invalidate here and, in cluster mode, in every sibling worker; bin/www
+// relays 'broadcast' messages between workers
+const invalidate = () => {
+    if (cluster.isWorker) {
+        process.send({ broadcast: INVALIDATE });
+    }
+    return invalidateLocal();
+};
+
+const watch = () => {
+    if (changeStream) {
+        return;
+    }
+    try {
+        changeStream = Trip.watch();
+    } catch (err) {
+        changeStream = null;
+        return;
+    }
+    // every worker watches for itself, so there's nothing to broadcast
+    changeStream.on('change', () => invalidateLocal());
+    changeStream.on('error', err => {
+        // standalone servers have no change streams; controller writes
+        // still invalidate, so just stop listening
+        console.log('Trip change stream unavailable:', err.message);
+        changeStream.close();
+        changeStream = null;
+    });
+};
+
+const warm = () => {
+    watch();
+    return load().catch(() => null);
+};
+
+const isWarm = () => trips !== null;
+
+// Cached catalog, or null if the cache is cold
+const list = () => trips;
+
+// Cached trip with the given code, or null if it doesn't exist or the
+// cache is cold
+const findByCode = code => byCode.get(code) || null;
+
+// Serialized catalog, or null if the cache is cold
+const getListEntry = () => listEntry;
+
+// Serialized trip with the given code, or null if it doesn't exist or the
+// cache is cold
+const getCodeEntry = code => {
+    let entry = codeEntries.get(code);
+    if (!entry) {
+        const trip = findByCode(code);
+        if (!trip) {
+            return null;
+        }
+        entry = toEntry(trip);
+        codeEntries.set(code, entry);
+    }
+    return entry;
+};
+
+const getVersion = () => version;
+
+mongoose.connection.on('connected', warm);
+mongoose.connection.on('reconnected', warm);
+mongoose.connection.on('disconnected', () => {
+    if (changeStream) {
+        changeStream.close();
+        changeStream = null;
+    }
+});
+if (cluster.isWorker) {
+    process.on('message', message => {
+        if (message && message.broadcast === INVALIDATE) {
+            invalidateLocal();
+        }
+    });
+}
+if (mongoose.connection.readyState === 1) {
+    warm();
+}
+
+module.exports = {
+    warm,
+    invalidate,
+    isWarm,
+    list,
+    findByCode,
+    getListEntry,
+    getCodeEntry,
+    getVersion,
+    events
+};
@@ -0,0 +1,38 @@
+// Trip reads shared by the API controllers and the server-rendered pages.
+// Served from tripCache when it's warm, otherwise straight from MongoDB;
+// either way as plain objects, so callers never go back through HTTP to get
+// at the catalog.
+
+const mongoose = require('mongoose');
+const Trip = mongoose.model('trips');
+const { tripReads } = require('../database/db');
+const tripCache = require('./tripCache');
+
+// Promise of the whole catalog
+const listTrips = () => {
+    if (tripCache.isWarm()) {
+        return Promise.resolve(tripCache.list());
+    }
+    return Trip
+        .find({}) // empty filter for all
+        .setOptions(tripReads)
+        .lean() // plain objects, nothing to hydrate just to re-serialize
+        .exec();
+};
+
+// Promise of the trip with the given code, or null
+const findTrip = code => {
+    if (tripCache.isWarm()) {
+        return Promise.resolve(tripCache.findByCode(code));
+    }
+    return Trip
+        .findOne({ 'code': code }) // point lookup on the unique index
+        .setOptions(tripReads)
+        .lean()
+        .exec();
+};
+
+module.exports = {
+    listTrips,
+    findTrip
+};
@@ -0,0 +1,231 @@
+// Parses the paging, filtering and projection parameters accepted by
+// GET /api/trips.
+//   ?limit=N          page size (1..MAX_LIMIT)
+//   ?after=CURSOR     keyset cursor from the previous page's Link header;
+//                     for the default code order it is simply the last code
+//   ?fields=a,b       include only these fields, or ?fields=-a,-b to leave them out
+//   ?minPrice=&maxPrice=  per-person price range, e.g. 799.00
+//   ?from=&to=        start date range (ISO dates)
+//   ?minNights=N      shortest acceptable stay
+//   ?sort=KEY         code (default), price, start or nights; prefix - to reverse;
+//                     trips without a typed price/nights (unparseable or not
+//                     yet migrated) are left out of those sorts
+// Every sort key has a matching (key, code) index on the trip schema, so a
+// filtered page is a bounded index range scan however large the catalog grows.
+
+const mongoose = require('mongoose');
+const Trip = mongoose.model('trips');
+
+const DEFAULT_LIMIT = 100;
+const MAX_LIMIT = 500;
+const FIELDS = Object.keys(Trip.schema.paths).filter(path => path !== '__v');
+const SORT_KEYS = ['code', 'price', 'start', 'nights'];
+const PARAMS = ['limit', 'after', 'fields', 'minPrice', 'maxPrice', 'from', 'to', 'minNights', 'sort'];
+
+const isPaged = query => PARAMS.some(param => query[param] !== undefined);
+
+const parseLimit = value => {
+    if (value === undefined) {
+        return DEFAULT_LIMIT;
+    }
+    const limit = Number(value);
+    if (!Number.isInteger(limit) || limit < 1 || limit > MAX_LIMIT) {
+        return null;
+    }
+    return limit;
+};
+
+const parseSort = value => {
+    const descending = typeof value === 'string' && value.startsWith('-');
+    const key = value === undefined ? 'code' : String(value).slice(descending ? 1 : 0);
+    if (!SORT_KEYS.includes(key)) {
+        return null;
+    }
+    return { key, direction: descending ? -1 : 1 };
+};
+
+// The paging key(s) always stay in the projection so the cursor can be built
+const parseFields = (value, sortKey) => {
+    if (value === undefined || value === '') {
+        return {};
+    }
+    const names = String(value).split(',').map(name => name.trim()).filter(Boolean);
+    const excluding = names.every(name => name.startsWith('-'));
+    if (!excluding && names.some(name => name.startsWith('-'))) {
+        return null; // MongoDB can't mix inclusion and exclusion
+    }
+    const projection = {};
+    for (const name of names) {
+        const field = excluding ? name.slice(1) : name;
+        if (!FIELDS.includes(field)) {
+            return null;
+        }
+        if (field !== 'code' && field !== sortKey) {
+            projection[field] = excluding ? 0 : 1;
+        }
+    }
+    if (!excluding) {
+        // even when only paging keys were named, e.g. ?fields=code
+        projection.code = 1;
+        projection[sortKey] = 1;
+    }
+    return projection;
+};
+
+const parseNumber = value => {
+    const number = Number(value);
+    return value === '' || !Number.isFinite(number) || number < 0 ? null : number;
+};
+
+const parseDate = value => {
+    const date = new Date(value);
+    return isNaN(date) ? null : date;
+};
+
+// Range filters on the typed price/nights fields and the start date
+const parseFilter = query => {
+    const filter = {};
+    const price = {};
+    if (query.minPrice !== undefined) {
+        const min = parseNumber(query.minPrice);
+        if (min === null) {
+            return { error: 'minPrice must be a non-negative number' };
+        }
+        price.$gte = Math.round(min * 100);
+    }
+    if (query.maxPrice !== undefined) {
+        const max = parseNumber(query.maxPrice);
+        if (max === null) {
+            return { error: 'maxPrice must be a non-negative number' };
+        }
+        price.$lte = Math.round(max * 100);
+    }
+    if (Object.keys(price).length) {
+        filter.price = price;
+    }
+    const start = {};
+    if (query.from !== undefined) {
+        const from = parseDate(query.from);
+        if (!from) {
+            return { error: 'from must be a date' };
+        }
+        start.$gte = from;
+    }
+    if (query.to !== undefined) {
+        const to = parseDate(query.to);
+        if (!to) {
+            return { error: 'to must be a date' };
+        }
+        start.$lte = to;
+    }
+    if (Object.keys(start).length) {
+        filter.start = start;
+    }
+    if (query.minNights !== undefined) {
+        const nights = parseNumber(query.minNights);
+        if (nights === null || !Number.isInteger(nights)) {
+            return { error: 'minNights must be a non-negative integer' };
+        }
+        filter.nights = { $gte: nights };
+    }
+    return { filter };
+};
+
+// Cursors for non-code sorts carry the sort value and the code tie-breaker
+const encodeCursor = (sort, trip) => {
+    if (sort.key === 'code') {
+        return trip.code;
+    }
+    const value = trip[sort.key] instanceof Date ? trip[sort.key].toISOString() : trip[sort.key];
+    return Buffer.from(JSON.stringify([value, trip.code])).toString('base64url');
+};
+
+const decodeCursor = (sort, cursor) => {
+    if (sort.key === 'code') {
+        return { code: String(cursor) };
+    }
+    try {
+        const [value, code] = JSON.parse(Buffer.from(String(cursor), 'base64url').toString());
+        if (typeof code !== 'string') {
+            return null;
+        }
+        return { value: sort.key === 'start' ? new Date(value) : value, code };
+    } catch (err) {
+        return null;
+    }
+};
+
+// Keyset condition selecting everything after the cursor in sort order
+const afterFilter = (sort, { value, code }) => {
+    const past = sort.direction === 1 ? '$gt' : '$lt';
+    if (sort.key === 'code') {
+        return { code: { [past]: code } };
+    }
+    return {
+        $or: [
+            { [sort.key]: { [past]: value } },
+            { [sort.key]: value, code: { [past]: code } }
+        ]
+    };
+};
+
+// Returns { filter, projection, sort, limit, cursor } or { error } for a bad
+// parameter; cursor(trip) builds the ?after= value for the page after 'trip'
+const parse = query => {
+    const limit = parseLimit(query.limit);
+    if (limit === null) {
+        return { error: `limit must be an integer from 1 to ${MAX_LIMIT}` };
+    }
+    const sort = parseSort(query.sort);
+    if (sort === null) {
+        return { error: `sort must be one of ${SORT_KEYS.join(', ')}, optionally prefixed with -` };
+    }
+    const projection = parseFields(query.fields, sort.key);
+    if (projection === null) {
+        return { error: `fields must list trip fields (${FIELDS.join(', ')})` };
+    }
+    const { filter, error } = parseFilter(query);
+    if (error) {
+        return { error };
+    }
+    if (sort.key !== 'code') {
+        // a missing key sorts as null, which no $gt/$lt cursor condition
+        // matches (type bracketing), so paging would silently skip or strand
+        // those trips; leave them out of the sort instead
+        filter[sort.key] = Object.assign({ $ne: null }, filter[sort.key]);
+    }
+    if (query.after !== undefined) {
+        const cursor = decodeCursor(sort, query.after);
+        if (!cursor) {
+            return { error: 'after is not a valid cursor for this sort' };
+        }
+        Object.assign(filter, afterFilter(sort, cursor));
+    }
+    return {
+        filter,
+        projection,
+        sort: sort.key === 'code'
+            ? { code: sort.direction }
+            : { [sort.key]: sort.direction, code: sort.direction },
+        limit,
+        cursor: trip => encodeCursor(sort, trip)
+    };
+};
+
+// Link header value for the page that follows 'cursor'
+const nextLink = (baseUrl, query, cursor) => {
+    const params = new URLSearchParams();
+    for (const param of PARAMS) {
+        if (query[param] !== undefined && param !== 'after') {
+            params.set(param, query[param]);
+        }
+    }
+    params.set('after', cursor);
+    return `<${baseUrl}?${params}>; rel="next"`;
+};
+
+module.exports = {
+    isPaged,
+    parse,
+    nextLink
+};
@@ -0,0 +1,82 @@
+// Builds the aggregation behind GET /api/trips/search.
+//   ?q=TEXT     words to match against name, resort and description
+//   ?page=N     1-based page of ranked results
+//   ?limit=N    results per page (1..MAX_LIMIT)
+// A single $facet pass over the text index match returns the ranked page,
+// the total hit count and hit counts by resort and by start month.
+
+const DEFAULT_LIMIT = 20;
+const MAX_LIMIT = 100;
+
+const parsePositive = (value, fallback, max) => {
+    if (value === undefined) {
+        return fallback;
+    }
+    const number = Number(value);
+    if (!Number.isInteger(number) || number < 1 || number > max) {
+        return null;
+    }
+    return number;
+};
+
+// Returns { q, page, limit } or { error } for a bad parameter
+const parse = query => {
+    const q = typeof query.q === 'string' ? query.q.trim() : '';
+    if (!q) {
+        return { error: 'q is required' };
+    }
+    const page = parsePositive(query.page, 1, Number.MAX_SAFE_INTEGER);
+    if (page === null) {
+        return { error: 'page must be a positive integer' };
+    }
+    const limit = parsePositive(query.limit, DEFAULT_LIMIT, MAX_LIMIT);
+    if (limit === null) {
+        return { error: `limit must be an integer from 1 to ${MAX_LIMIT}` };
+    }
+    return { q, page, limit };
+};
+
+const pipeline = ({ q, page, limit }) => [
+    { $match: { $text: { $search: q } } },
+    { $addFields: { score: { $meta: 'textScore' } } },
+    {
+        $facet: {
+            results: [
+                { $sort: { score: -1, code: 1 } },
+                { $skip: (page - 1) * limit },
+                { $limit: limit }
+            ],
+            total: [
+                { $count: 'count' }
+            ],
+            resort: [
+                { $group: { _id: '$resort', count: { $sum: 1 } } },
+                { $sort: { count: -1, _id: 1 } }
+            ],
+            month: [
+                { $group: { _id: { $dateToString: { format: '%Y-%m', date: '$start' } }, count: { $sum: 1 } } },
+                { $sort: { _id: 1 } }
+            ]
+        }
+    }
+];
+
+const toFacet = buckets => buckets.map(({ _id, count }) => ({ value: _id, count }));
+
+// Shapes the single $facet document into the response body
+const toResponse = ({ page, limit }, [facets]) => ({
+    page,
+    limit,
+    total: facets.total.length ? facets.total[0].count : 0,
+    results: facets.results,
+    facets: {
+        resort: toFacet(facets.resort),
+        month: toFacet(facets.month)
+    }
+});
+
+module.exports = {
+    parse,
+    pipeline,
+    toResponse
+};
@@ -0,0 +1,99 @@
+// Streams trips straight from a MongoDB cursor into the response, as a JSON
+// array or as NDJSON. Writes are batched and honour backpressure, so memory
+// use and time to first byte stay flat however large the catalog is.
+
+const mongoose = require('mongoose');
+const Trip = mongoose.model('trips');
+const { tripReads } = require('../database/db');
+
+const BATCH_SIZE = 500;       // documents per cursor round trip
+const CHUNK_BYTES = 64 * 1024; // buffered output per res.write()
+
+const FORMATS = {
+    json: {
+        type: 'application/json',
+        open: '[',
+        item: (json, index) => (index ? ',' : '') + json,
+        close: ']'
+    },
+    ndjson: {
+        type: 'application/x-ndjson',
+        open: '',
+        item: json => json + '\n',
+        close: ''
+    }
+};
+
+const isFormat = format => Object.prototype.hasOwnProperty.call(FORMATS, format);
+
+const streamTrips = async (res, format, filter, projection, sort) => {
+    const { type, open, item, close } = FORMATS[format];
+    const cursor = Trip
+        .find(filter, projection)
+        .setOptions(tripReads)
+        .sort(sort)
+        .batchSize(BATCH_SIZE)
+        .lean()
+        .cursor();
+
+    // One 'drain' and one 'close' listener for the whole stream, waking
+    // whichever write is waiting. compression() forwards res.on('drain') to
+    // its zlib stream but not removeListener, so listeners added per wait
+    // would pile up there.
+    let aborted = false;
+    let wake = null;
+    const resume = () => {
+        const waiting = wake;
+        wake = null;
+        if (waiting) {
+            waiting();
+        }
+    };
+    res.on('drain', resume);
+    res.on('close', () => {
+        aborted = !res.writableFinished;
+        resume();
+    });
+
+    res.status(200).type(type);
+    let chunk = open;
+    let index = 0;
+    try {
+        for await (const trip of cursor) {
+            if (aborted) {
+                break;
+            }
+            chunk += item(JSON.stringify(trip), index++);
+            if (chunk.length >= CHUNK_BYTES) {
+                const ok = res.write(chunk);
+                chunk = '';
+                if (!ok && !aborted) {
+                    await new Promise(resolve => {
+                        wake = resolve;
+                    });
+                }
+            }
+        }
+        if (!aborted) {
+            res.end(chunk + close);
+        }
+    } catch (err) {
+        console.log('Trip stream error:', err);
+        if (!res.headersSent) {
+            // nothing has gone out yet, so it can still be a proper error
+            res
+                .status(500)
+                .json({ "message": "trip stream failed" });
+        } else {
+            // part of the body is out, so cut it short rather than end it cleanly
+            res.destroy(err);
+        }
+    } finally {
+        await cursor.close().catch(() => null);
+    }
+};
+
+module.exports = {
+    isFormat,
+    streamTrips
+};
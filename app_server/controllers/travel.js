@@ -1,17 +1,15 @@
 const fs = require('fs');
 // Load the trips data from the JSON file
 const trips = JSON.parse(fs.readFileSync('./data/trips.json', 'utf8'));
-// Required module for making HTTP requests
-const request = require('request');
-
-const apiOptions = {
-    server: 'http://localhost:3000'
-};
-
-// render travel list view
-const renderTravelList = (req, res, responseBody) => {
+// Trip catalog read in-process, served stale rather than slow when MongoDB struggles
+const pageTrips = require('../services/pageTrips');
+const tracing = require('../../app_api/services/tracing');
+const pageCache = require('../services/pageCache');
+const views = require('../services/views');
+
+// locals for the travel list, from the catalog or null if it couldn't be read
+const travelLocals = responseBody => {
     let message = null;
-    let pageTitle = process.env.npm_package_description + ' - Travel';
 
     if (!(responseBody instanceof Array)) {
         message = 'API lookup error';
@@ -22,34 +20,42 @@ const renderTravelList = (req, res, responseBody) => {
         }
     }
 
-    res.render('travel', {
-        title: pageTitle,
+    return {
         trips: responseBody,
         message
-    });
+    };
 };
 
 
 // GET travel list view
-const travelList = (req, res) => {
-    const path = '/api/trips';
-    const requestOptions = {
-        url: `${apiOptions.server}${path}`,
-        method: 'GET',
-        json: {},
-    };
-
-    console.info('>> travelController.travelList calling ' + requestOptions.url);
-
-    request(
-        requestOptions,
-        (err, { statusCode }, body) => {
-            if (err) {
-                console.error(err);
+const travelList = (req, res, next) => {
+    const cached = pageCache.lookup(req);
+    if (cached) {
+        return pageCache.send(req, res, cached);
+    }
+    let token = pageCache.begin(req);
+    let pageTitle = process.env.npm_package_description + ' - Travel';
+    const span = tracing.startSpan('render travel', { 'view.name': 'travel' });
+
+    // <head>, the stylesheet link and the header go out before the catalog is read
+    views.stream(res, 'travel', { title: pageTitle }, () => pageTrips.getTrips()
+        .then(({ trips }) => travelLocals(trips), err => {
+            console.error(err);
+            token = null; // don't cache the error page
+            return travelLocals(null);
+        }))
+        .then(html => {
+            span.end();
+            if (token) {
+                pageCache.store(token, html);
             }
-            renderTravelList(req, res, body);
-        }
-    );
+        }, err => {
+            span.end(undefined, err);
+            if (!res.headersSent) {
+                return next(err);
+            }
+            res.destroy(err);
+        });
 };
 
 module.exports = {
@@ -0,0 +1,60 @@
+// Rendered HTML for server-side pages that look the same to every visitor
+// and depend only on the trip catalog. Pages are keyed by path and catalog
+// version and dropped as soon as tripCache invalidates or reloads, i.e. on
+// every API write. A hit skips both the catalog lookup and the template,
+// and its compressed copies are made once and reused (see precompress).
+
+const crypto = require('crypto');
+const tripCache = require('../../app_api/services/tripCache');
+const precompress = require('../../app_api/services/precompress');
+
+const MAX_PAGES = 100;
+
+const pages = new Map(); // `${version}:${path}` -> { body, etag, encoded }
+
+const clear = () => pages.clear();
+
+tripCache.events.on('invalidate', clear);
+tripCache.events.on('load', clear);
+
+const keyOf = (path, version) => `${version}:${path}`;
+
+// Cached page for this request, or null
+const lookup = req => {
+    if (!tripCache.isWarm()) {
+        return null;
+    }
+    return pages.get(keyOf(req.baseUrl + req.path, tripCache.getVersion())) || null;
+};
+
+// Taken before fetching the data a page renders from; store() only keeps
+// the page if the catalog was warm then and hasn't changed since
+const begin = req => ({
+    path: req.baseUrl + req.path,
+    version: tripCache.isWarm() ? tripCache.getVersion() : null
+});
+
+// Cache the rendered 'html' against 'token'; returns the entry, or null if
+// the catalog moved on while the page was rendering
+const store = (token, html) => {
+    if (token.version === null || !tripCache.isWarm() || tripCache.getVersion() !== token.version) {
+        return null;
+    }
+    const hash = crypto.createHash('sha1').update(html).digest('base64');
+    const entry = { body: html, etag: `"${hash}"` };
+    if (pages.size >= MAX_PAGES) {
+        pages.delete(pages.keys().next().value);
+    }
+    pages.set(keyOf(token.path, token.version), entry);
+    return entry;
+};
+
+// Send a cached page (ETag/304, precompressed)
+const send = (req, res, entry) => precompress.send(req, res, entry, 'html');
+
+module.exports = {
+    lookup,
+    begin,
+    store,
+    send
+};
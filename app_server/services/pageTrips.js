@@ -0,0 +1,89 @@
+// Trip catalog for server-rendered pages, with bounded latency. While
+// tripCache is warm that's the cache. When it isn't (after a write, or
+// while MongoDB is struggling) pages get the last catalog they rendered
+// straight away and a refresh runs in the background. Only a page with
+// nothing to fall back on waits, and for at most SSR_DATA_TIMEOUT_MS.
+// After SSR_BREAKER_THRESHOLD consecutive failures or timeouts the breaker
+// opens: for SSR_BREAKER_COOLDOWN_MS no fetches are attempted, then a
+// single trial fetch decides whether it closes again.
+
+const tripCache = require('../../app_api/services/tripCache');
+const tripData = require('../../app_api/services/tripData');
+
+const TIMEOUT_MS = parseInt(process.env.SSR_DATA_TIMEOUT_MS, 10) || 2000;
+const FAILURE_THRESHOLD = parseInt(process.env.SSR_BREAKER_THRESHOLD, 10) || 5;
+const COOLDOWN_MS = parseInt(process.env.SSR_BREAKER_COOLDOWN_MS, 10) || 30 * 1000;
+
+let lastGood = null;     // last catalog read successfully
+let failures = 0;        // consecutive failed or timed-out fetches
+let openUntil = 0;       // breaker is open until this time
+let refreshing = null;   // the fetch in flight, shared by every caller
+
+const isOpen = () => Date.now() < openUntil;
+
+// Track every catalog the cache loads, not just the ones a page happened
+// to render from, so an outage right after a reload still has the latest
+tripCache.events.on('load', () => {
+    lastGood = tripCache.list();
+});
+
+const withTimeout = promise => new Promise((resolve, reject) => {
+    const timer = setTimeout(() => {
+        const err = new Error(`Trip data timed out after ${TIMEOUT_MS} ms`);
+        err.code = 'ETIMEDOUT';
+        reject(err);
+    }, TIMEOUT_MS);
+    promise.then(value => {
+        clearTimeout(timer);
+        resolve(value);
+    }, err => {
+        clearTimeout(timer);
+        reject(err);
+    });
+});
+
+const refresh = () => {
+    if (!refreshing) {
+        refreshing = withTimeout(tripData.listTrips())
+            .then(trips => {
+                lastGood = trips;
+                failures = 0;
+                openUntil = 0;
+                return trips;
+            }, err => {
+                failures++;
+                if (failures >= FAILURE_THRESHOLD) {
+                    openUntil = Date.now() + COOLDOWN_MS;
+                    console.log(`Trip data circuit open for ${COOLDOWN_MS} ms after ${failures} failures:`, err.message);
+                }
+                throw err;
+            })
+            .finally(() => {
+                refreshing = null;
+            });
+    }
+    return refreshing;
+};
+
+// Promise of { trips, stale }; rejects only when there's no catalog to
+// fall back on and it can't be fetched in time (or the breaker is open)
+const getTrips = () => {
+    if (tripCache.isWarm()) {
+        lastGood = tripCache.list();
+        return Promise.resolve({ trips: lastGood, stale: false });
+    }
+    if (lastGood) {
+        if (!isOpen()) {
+            refresh().catch(() => null);
+        }
+        return Promise.resolve({ trips: lastGood, stale: true });
+    }
+    if (isOpen()) {
+        return Promise.reject(new Error('Trip data circuit open'));
+    }
+    return refresh().then(trips => ({ trips, stale: false }));
+};
+
+module.exports = {
+    getTrips
+};
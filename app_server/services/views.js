@@ -0,0 +1,106 @@
+// Handlebars views compiled once, at startup, rather than on first render.
+// Partials are registered as compiled templates under their file name
+// (views/partials/header.hbs is {{> header}}). Templates may be split with
+// {{!-- flush --}} markers: stream() sends everything before the first
+// marker straight away and the rest once the page's data is ready.
+// With 'view cache' off (development) templates are re-read on every
+// render, as hbs does, so edits show up without a restart.
+
+const fs = require('fs');
+const path = require('path');
+const hbs = require('hbs');
+
+const handlebars = hbs.handlebars;
+const EXTENSION = '.hbs';
+const FLUSH = /\{\{!--\s*flush\s*--\}\}/;
+
+let viewsDir = null;
+let layoutFile = null;   // views/layout.hbs, if there is one
+const templates = new Map(); // absolute path -> compiled parts
+
+// Full (non-lazy) compile, the same as handlebars' own precompiler
+const compile = source => handlebars.template(new Function(`return ${handlebars.precompile(source)}`)());
+
+const compileFile = file => fs.readFileSync(file, 'utf8').split(FLUSH).map(compile);
+
+const walk = dir => fs.readdirSync(dir, { withFileTypes: true })
+    .flatMap(entry => {
+        const file = path.join(dir, entry.name);
+        if (entry.isDirectory()) {
+            return walk(file);
+        }
+        return entry.name.endsWith(EXTENSION) ? [file] : [];
+    });
+
+// Compile every template and partial under 'dir'; throws on a syntax error
+// so a broken view stops startup instead of the first request that uses it
+const precompile = dir => {
+    viewsDir = dir;
+    const partialsDir = path.join(dir, 'partials');
+    walk(dir).forEach(file => {
+        if (file.startsWith(partialsDir + path.sep)) {
+            const name = path.relative(partialsDir, file).slice(0, -EXTENSION.length).split(path.sep).join('/');
+            handlebars.registerPartial(name, compile(fs.readFileSync(file, 'utf8')));
+        } else {
+            templates.set(file, compileFile(file));
+        }
+    });
+    const layout = path.join(dir, 'layout' + EXTENSION);
+    layoutFile = templates.has(layout) ? layout : null;
+};
+
+const lookup = (file, cache) => {
+    if (cache && templates.has(file)) {
+        return templates.get(file);
+    }
+    const parts = compileFile(file);
+    if (cache) {
+        templates.set(file, parts);
+    }
+    return parts;
+};
+
+const renderParts = (parts, context) => parts.map(part => part(context)).join('');
+
+// Express view engine for .hbs. Like hbs, wraps the page in views/layout.hbs
+// ({{{body}}}) when that exists, unless the locals say layout: false
+const engine = (file, options, callback) => {
+    let html;
+    try {
+        html = renderParts(lookup(file, options.cache), options);
+        if (layoutFile && options.layout !== false) {
+            html = renderParts(lookup(layoutFile, options.cache), Object.assign({}, options, { body: html }));
+        }
+    } catch (err) {
+        return callback(err);
+    }
+    callback(null, html);
+};
+
+// Render view 'name' onto 'res' in stages. The part before the first flush
+// marker is rendered from 'locals' and flushed at once (through compression,
+// if it's active); 'more' then returns a promise of the remaining locals,
+// which the rest of the template is rendered with. No layout is applied.
+// Resolves to the whole page's HTML.
+const stream = async (res, name, locals, more) => {
+    const parts = lookup(path.join(viewsDir, name + EXTENSION), res.app.enabled('view cache'));
+    const context = Object.assign({}, res.app.locals, res.locals, locals);
+    const head = parts[0](context);
+    res
+        .status(200)
+        .type('html');
+    res.write(head);
+    if (res.flush) {
+        res.flush();
+    }
+    Object.assign(context, await more());
+    const rest = renderParts(parts.slice(1), context);
+    res.end(rest);
+    return head + rest;
+};
+
+module.exports = {
+    precompile,
+    engine,
+    stream
+};
@@ -0,0 +1,68 @@
+// Compares the hydrated and lean trip read paths without needing a database.
+// Raw documents are shaped like the driver returns them; the hydrated path
+// runs them through Trip.hydrate() as Query#exec() does, the lean path uses
+// them as they are. Both are then serialized the way res.json() would.
+//
+//   node --expose-gc bench/lean.js [trips] [iterations]
+
+const mongoose = require('mongoose');
+const Trip = require('../app_api/database/models/travlr');
+const seed = Object.values(require('../data/trips.json'));
+
+const count = parseInt(process.argv[2], 10) || 1000;
+const iterations = parseInt(process.argv[3], 10) || 50;
+
+if (!global.gc) {
+    console.error('run with node --expose-gc so retained heap can be measured');
+    process.exit(1);
+}
+
+const raw = Array.from({ length: count }, (_, i) => {
+    const trip = seed[i % seed.length];
+    return {
+        _id: new mongoose.Types.ObjectId(),
+        code: `${trip.code}-${i}`,
+        name: trip.name,
+        length: trip.length,
+        start: new Date(trip.start),
+        resort: trip.resort,
+        perPerson: trip.perPerson,
+        image: trip.image,
+        description: trip.description,
+        __v: 0
+    };
+});
+
+const paths = {
+    hydrated: docs => docs.map(doc => Trip.hydrate(doc)),
+    lean: docs => docs.slice() // the driver's objects are handed back untouched
+};
+
+// Heap retained by one materialized result set, on top of the driver's docs
+const retainedBytes = materialize => {
+    global.gc();
+    const before = process.memoryUsage().heapUsed;
+    const held = materialize(raw);
+    global.gc();
+    const after = process.memoryUsage().heapUsed;
+    return held.length ? after - before : 0;
+};
+
+// Average CPU microseconds per request to materialize and serialize
+const cpuMicros = materialize => {
+    JSON.stringify(materialize(raw)); // warm up
+    const start = process.cpuUsage();
+    for (let i = 0; i < iterations; i++) {
+        JSON.stringify(materialize(raw));
+    }
+    const used = process.cpuUsage(start);
+    return (used.user + used.system) / iterations;
+};
+
+console.log(`${count} trips, ${iterations} iterations`);
+for (const [name, materialize] of Object.entries(paths)) {
+    const bytes = retainedBytes(materialize);
+    const micros = cpuMicros(materialize);
+    console.log(`${name.padEnd(8)} ${(micros / 1000).toFixed(2).padStart(9)} ms cpu/request ` +
+        `${(bytes / 1024).toFixed(0).padStart(9)} KB retained`);
+}
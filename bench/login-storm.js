@@ -0,0 +1,96 @@
+// Shows how a login storm affects everything else on the event loop.
+// A local HTTP server stands in for /api/trips (it serializes the catalog)
+// while bursts of password checks arrive, first hashed with the old
+// synchronous pbkdf2Sync, then through passwordHasher. Read latency is
+// sampled throughout with a steady stream of requests.
+//
+//   node bench/login-storm.js [logins]
+
+const crypto = require('crypto');
+const http = require('http');
+const passwordHasher = require('../app_api/services/passwordHasher');
+const trips = Object.values(require('../data/trips.json'));
+
+const logins = parseInt(process.argv[2], 10) || 2000;
+const salt = crypto.randomBytes(16).toString('hex');
+
+const server = http.createServer((req, res) => {
+    res.setHeader('Content-Type', 'application/json');
+    res.end(JSON.stringify(trips));
+});
+
+const agent = new http.Agent({ keepAlive: true, maxSockets: 8 });
+
+const read = port => new Promise((resolve, reject) => {
+    const start = process.hrtime.bigint();
+    http.get({ port, agent, path: '/api/trips' }, res => {
+        res.resume();
+        res.on('end', () => resolve(Number(process.hrtime.bigint() - start) / 1e6));
+    }).on('error', reject);
+});
+
+const percentile = (sorted, p) => sorted[Math.min(sorted.length - 1, Math.floor(sorted.length * p))];
+
+// Issue reads every 2 ms until 'storm' settles, collecting their latencies
+const sampleDuring = async (port, storm) => {
+    const latencies = [];
+    const inFlight = [];
+    const timer = setInterval(() => {
+        inFlight.push(read(port).then(ms => latencies.push(ms)));
+    }, 2);
+    const start = process.hrtime.bigint();
+    const outcome = await storm();
+    const elapsed = Number(process.hrtime.bigint() - start) / 1e6;
+    clearInterval(timer);
+    await Promise.all(inFlight);
+    latencies.sort((a, b) => a - b);
+    return { outcome, elapsed, latencies };
+};
+
+// Logins arrive in bursts, as concurrent requests landing in one poll phase
+const BURST = 50;
+const BURST_INTERVAL = 10;
+
+const bursts = handle => new Promise(resolve => {
+    const pending = [];
+    let sent = 0;
+    const timer = setInterval(() => {
+        for (let i = 0; i < BURST && sent < logins; i++, sent++) {
+            pending.push(handle());
+        }
+        if (sent >= logins) {
+            clearInterval(timer);
+            resolve(Promise.all(pending));
+        }
+    }, BURST_INTERVAL);
+});
+
+// The old path: every login blocks the loop for a full pbkdf2Sync
+const syncStorm = () => bursts(() => {
+    crypto.pbkdf2Sync('correct horse battery staple', salt, 1000, 64, 'sha512');
+    return 0;
+}).then(() => '0 shed');
+
+// Logins beyond the queue limit are shed, as /api/login would answer 429
+const pooledStorm = () => bursts(() => passwordHasher.hash('correct horse battery staple', salt)
+    .then(() => 0, () => 1))
+    .then(shed => `${shed.reduce((a, b) => a + b, 0)} shed`);
+
+const report = (name, { outcome, elapsed, latencies }) => {
+    console.log(`${name.padEnd(8)} storm ${elapsed.toFixed(0).padStart(6)} ms  ` +
+        `reads ${String(latencies.length).padStart(5)}  ` +
+        `p50 ${percentile(latencies, 0.5).toFixed(2).padStart(7)} ms  ` +
+        `p99 ${percentile(latencies, 0.99).toFixed(2).padStart(7)} ms  ` +
+        `max ${latencies[latencies.length - 1].toFixed(2).padStart(7)} ms` +
+        (typeof outcome === 'string' ? `  (${outcome})` : ''));
+};
+
+server.listen(0, async () => {
+    const { port } = server.address();
+    console.log(`${logins} logins, limits ${JSON.stringify(passwordHasher.stats())}`);
+    report('idle', await sampleDuring(port, () => new Promise(resolve => setTimeout(resolve, 500))));
+    report('sync', await sampleDuring(port, syncStorm));
+    report('pooled', await sampleDuring(port, pooledStorm));
+    agent.destroy();
+    server.close();
+});
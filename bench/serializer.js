@@ -0,0 +1,103 @@
+// Measures trip list serialization over 1k, 10k and 100k trips:
+//   hydrated   res.json() on Mongoose documents, the original read path
+//   lean       JSON.stringify on lean objects, what /api/trips does now
+//   compiled   a serializer generated from the Trip schema, field by field
+// Every candidate must produce the same bytes as JSON.stringify.
+//
+//   node bench/serializer.js [iterations]
+
+const mongoose = require('mongoose');
+const Trip = require('../app_api/database/models/travlr');
+const seed = Object.values(require('../data/trips.json'));
+
+const iterations = parseInt(process.argv[2], 10) || 10;
+const sizes = [1000, 10000, 100000];
+
+// Strings without quotes, backslashes, control characters or surrogates
+// can be quoted as-is, skipping JSON.stringify's escaping pass
+const NEEDS_ESCAPE = /["\\\u0000-\u001f\ud800-\udfff]/;
+
+const encoders = {
+    String: '(!NEEDS_ESCAPE.test(v) ? \'"\' + v + \'"\' : JSON.stringify(v))',
+    Number: '(isFinite(v) ? String(v) : "null")',
+    Date: '\'"\' + v.toISOString() + \'"\'',
+    ObjectID: '\'"\' + v.toHexString() + \'"\''
+};
+
+const compile = schema => {
+    const names = Object.keys(schema.paths).filter(name => name !== '_id' && name !== '__v');
+    let source = 'let out = "{"; let sep = ""; let v;\n';
+    for (const name of ['_id', ...names, '__v']) {
+        const type = schema.paths[name] ? schema.paths[name].instance : 'Number';
+        source +=
+            `v = t[${JSON.stringify(name)}];\n` +
+            'if (v !== undefined) {\n' +
+            `    out += sep + ${JSON.stringify(JSON.stringify(name) + ':')} + ` +
+            `(v === null ? "null" : ${encoders[type] || 'JSON.stringify(v)'});\n` +
+            '    sep = ",";\n' +
+            '}\n';
+    }
+    return new Function('NEEDS_ESCAPE', 't', source + 'return out + "}";').bind(null, NEEDS_ESCAPE);
+};
+
+const serializeTrip = compile(Trip.schema);
+
+const makeTrips = count => Array.from({ length: count }, (_, i) => {
+    const trip = seed[i % seed.length];
+    return {
+        _id: new mongoose.Types.ObjectId(),
+        code: `${trip.code}-${i}`,
+        name: trip.name,
+        length: trip.length,
+        start: new Date(trip.start),
+        resort: trip.resort,
+        perPerson: trip.perPerson,
+        image: trip.image,
+        description: trip.description,
+        __v: 0
+    };
+});
+
+const candidates = {
+    hydrated: trips => {
+        const docs = trips.map(trip => Trip.hydrate(trip));
+        return () => JSON.stringify(docs);
+    },
+    lean: trips => () => JSON.stringify(trips),
+    compiled: trips => () => {
+        const parts = new Array(trips.length);
+        for (let i = 0; i < trips.length; i++) {
+            parts[i] = serializeTrip(trips[i]);
+        }
+        return '[' + parts.join(',') + ']';
+    }
+};
+
+// Trips serialized per second
+const throughput = (serialize, count) => {
+    serialize(); // warm up
+    const start = process.hrtime.bigint();
+    for (let i = 0; i < iterations; i++) {
+        serialize();
+    }
+    const seconds = Number(process.hrtime.bigint() - start) / 1e9;
+    return count * iterations / seconds;
+};
+
+for (const size of sizes) {
+    const trips = makeTrips(size);
+    const expected = JSON.stringify(trips);
+    console.log(`${size} trips`);
+    let baseline = null;
+    for (const [name, prepare] of Object.entries(candidates)) {
+        const serialize = prepare(trips);
+        if (serialize() !== expected) {
+            console.error(`${name} output differs from JSON.stringify`);
+            process.exit(1);
+        }
+        const perSecond = throughput(serialize, size);
+        baseline = baseline || perSecond;
+        console.log(`  ${name.padEnd(9)} ${Math.round(perSecond).toLocaleString().padStart(12)} trips/s ` +
+            `${(perSecond / baseline).toFixed(2)}x`);
+    }
+}